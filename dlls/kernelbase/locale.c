@@ -639,6 +639,26 @@ static void init_sortkeys( DWORD *ptr )
 }
 
 
+/* collation elements of the ASCII characters that always compare by their plain weights, 0 for others */
+static unsigned int ascii_collation[128];
+
+static void init_ascii_collation(void)
+{
+    unsigned int ce;
+    WCHAR ch;
+
+    for (ch = 0; ch < ARRAY_SIZE( ascii_collation ); ch++)
+    {
+        /* hyphen and apostrophe are skipped depending on SORT_STRINGSORT */
+        if (ch == '-' || ch == '\'') continue;
+        ce = collation_table[collation_table[collation_table[ch >> 8] + ((ch >> 4) & 0x0f)] + (ch & 0xf)];
+        /* characters with an empty weight are skipped when comparing */
+        if (ce == ~0u || !(ce >> 16) || !((ce >> 8) & 0xff) || !((ce >> 4) & 0x0f)) continue;
+        ascii_collation[ch] = ce;
+    }
+}
+
+
 static const struct sortguid *find_sortguid( const GUID *guid )
 {
     int pos, ret, min = 0, max = sort.guid_count - 1;
@@ -761,6 +781,7 @@ void init_locale(void)
     NtGetNlsSectionPtr( 9, 0, NULL, &sort_ptr, &size );
     NtGetNlsSectionPtr( 12, NormalizationC, NULL, (void **)&norm_info, &size );
     init_sortkeys( sort_ptr );
+    init_ascii_collation();
 
     if (!ansi_cp || NtGetNlsSectionPtr( 11, ansi_cp, NULL, (void **)&ansi_ptr, &size ))
         NtGetNlsSectionPtr( 11, 1252, NULL, (void **)&ansi_ptr, &size );
@@ -2613,6 +2634,43 @@ static int compare_weights(int flags, const WCHAR *str1, int len1,
 }
 
 
+/* same result as the compare_weights passes for strings of plain ASCII characters,
+ * returns FALSE if the strings need the full comparison */
+static BOOL compare_ascii_weights( DWORD flags, const WCHAR *str1, int len1,
+                                   const WCHAR *str2, int len2, int *ret )
+{
+    int i, len = min( len1, len2 ), diacritic = 0, case_weight = 0;
+    unsigned int ce1, ce2;
+
+    if (flags & NORM_IGNORESYMBOLS) return FALSE;
+
+    for (i = 0; i < len; i++)
+    {
+        if (str1[i] >= ARRAY_SIZE( ascii_collation ) || !(ce1 = ascii_collation[str1[i]])) return FALSE;
+        if (str2[i] >= ARRAY_SIZE( ascii_collation ) || !(ce2 = ascii_collation[str2[i]])) return FALSE;
+        if (ce1 == ce2) continue;
+        /* characters are never skipped, so the first unicode weight difference decides */
+        if ((ce1 >> 16) != (ce2 >> 16))
+        {
+            *ret = (ce1 >> 16) - (ce2 >> 16);
+            return TRUE;
+        }
+        if (!diacritic) diacritic = ((ce1 >> 8) & 0xff) - ((ce2 >> 8) & 0xff);
+        if (!case_weight) case_weight = ((ce1 >> 4) & 0x0f) - ((ce2 >> 4) & 0x0f);
+    }
+    for (i = len; i < len1; i++)
+        if (str1[i] >= ARRAY_SIZE( ascii_collation ) || !ascii_collation[str1[i]]) return FALSE;
+    for (i = len; i < len2; i++)
+        if (str2[i] >= ARRAY_SIZE( ascii_collation ) || !ascii_collation[str2[i]]) return FALSE;
+
+    if (len1 != len2) *ret = len1 - len2;
+    else if (!(flags & NORM_IGNORENONSPACE) && diacritic) *ret = diacritic;
+    else if (!(flags & NORM_IGNORECASE)) *ret = case_weight;
+    else *ret = 0;
+    return TRUE;
+}
+
+
 static const struct geoinfo *get_geoinfo_ptr( GEOID geoid )
 {
     int min = 0, max = ARRAY_SIZE( geoinfodata )-1;
@@ -3086,13 +3144,16 @@ INT WINAPI CompareStringEx( const WCHAR *locale, DWORD flags, const WCHAR *str1,
     if (len1 < 0) len1 = lstrlenW(str1);
     if (len2 < 0) len2 = lstrlenW(str2);
 
-    ret = compare_weights( flags, str1, len1, str2, len2, UNICODE_WEIGHT );
-    if (!ret)
+    if (!compare_ascii_weights( flags, str1, len1, str2, len2, &ret ))
     {
-        if (!(flags & NORM_IGNORENONSPACE))
-            ret = compare_weights( flags, str1, len1, str2, len2, DIACRITIC_WEIGHT );
-        if (!ret && !(flags & NORM_IGNORECASE))
-            ret = compare_weights( flags, str1, len1, str2, len2, CASE_WEIGHT );
+        ret = compare_weights( flags, str1, len1, str2, len2, UNICODE_WEIGHT );
+        if (!ret)
+        {
+            if (!(flags & NORM_IGNORENONSPACE))
+                ret = compare_weights( flags, str1, len1, str2, len2, DIACRITIC_WEIGHT );
+            if (!ret && !(flags & NORM_IGNORECASE))
+                ret = compare_weights( flags, str1, len1, str2, len2, CASE_WEIGHT );
+        }
     }
     if (!ret) return CSTR_EQUAL;
     return (ret < 0) ? CSTR_LESS_THAN : CSTR_GREATER_THAN;
@@ -170,8 +170,8 @@ struct SchedulerVtbl {
     unsigned int (__thiscall *Release)(Scheduler*);
     void (__thiscall *RegisterShutdownEvent)(Scheduler*,HANDLE);
     void (__thiscall *Attach)(Scheduler*);
-    /* CreateScheduleGroup */
-    /* ScheduleTask */
+    /*ScheduleGroup*/void* (__thiscall *CreateScheduleGroup)(Scheduler*);
+    void (__thiscall *ScheduleTask)(Scheduler*,void (__cdecl*)(void*),void*);
 };
 
 static int* (__cdecl *p_errno)(void);
@@ -956,11 +956,26 @@ static void test_ExternalContextBase(void)
     CloseHandle(thread);
 }
 
+struct schedule_task_data {
+    Scheduler *scheduler;
+    HANDLE event;
+};
+
+static void __cdecl schedule_task_proc(void *arg)
+{
+    struct schedule_task_data *data = arg;
+
+    data->scheduler = p_CurrentScheduler_Get();
+    SetEvent(data->event);
+}
+
 static void test_Scheduler(void)
 {
     Scheduler *scheduler, *current_scheduler;
+    struct schedule_task_data data;
     SchedulerPolicy policy;
     unsigned int i;
+    DWORD ret;
 
     call_func1(p_SchedulerPolicy_ctor, &policy);
     scheduler = p_Scheduler_Create(&policy);
@@ -985,6 +1000,15 @@ static void test_Scheduler(void)
 
     i = call_func1(scheduler->vtable->GetNumberOfVirtualProcessors, scheduler);
     ok(i == 1, "Scheduler::GetNumberOfVirtualProcessors() = %u\n", i);
+
+    data.scheduler = NULL;
+    data.event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    call_func3(scheduler->vtable->ScheduleTask, scheduler, schedule_task_proc, &data);
+    ret = WaitForSingleObject(data.event, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %d\n", ret);
+    ok(data.scheduler == scheduler, "task ran on scheduler %p, expected %p\n",
+            data.scheduler, scheduler);
+    CloseHandle(data.event);
     call_func1(scheduler->vtable->Release, scheduler);
     call_func1(p_SchedulerPolicy_dtor, &policy);
 }
@@ -135,6 +135,8 @@ typedef struct {
     int shutdown_size;
     HANDLE *shutdown_events;
     CRITICAL_SECTION cs;
+    TP_POOL *pool;
+    TP_CALLBACK_ENVIRON pool_env;
 } ThreadScheduler;
 extern const vtable_ptr ThreadScheduler_vtable;
 
@@ -1106,6 +1108,8 @@ static void ThreadScheduler_dtor(ThreadScheduler *this)
         SetEvent(this->shutdown_events[i]);
     operator_delete(this->shutdown_events);
 
+    if(this->pool) CloseThreadpool(this->pool);
+
     this->cs.DebugInfo->Spare[0] = 0;
     DeleteCriticalSection(&this->cs);
 }
@@ -1217,18 +1221,104 @@ DEFINE_THISCALL_WRAPPER(ThreadScheduler_CreateScheduleGroup, 4)
     return NULL;
 }
 
+typedef struct {
+    void (__cdecl *proc)(void*);
+    void *data;
+    ThreadScheduler *scheduler;
+} schedule_task_arg;
+
+void __cdecl CurrentScheduler_Detach(void);
+
+static void WINAPI schedule_task_proc(PTP_CALLBACK_INSTANCE instance, void *context)
+{
+    schedule_task_arg arg;
+    BOOL detach = FALSE;
+
+    arg = *(schedule_task_arg*)context;
+    operator_delete(context);
+
+    if(&arg.scheduler->scheduler != get_current_scheduler()) {
+        ThreadScheduler_Attach(arg.scheduler);
+        detach = TRUE;
+    }
+    ThreadScheduler_Release(arg.scheduler);
+
+    arg.proc(arg.data);
+
+    if(detach)
+        CurrentScheduler_Detach();
+}
+
+/* Tasks run on a thread pool private to the scheduler, so that the pool
+ * size follows the MinConcurrency and MaxConcurrency policy values. */
+static TP_CALLBACK_ENVIRON* ThreadScheduler_get_pool_env(ThreadScheduler *this)
+{
+    TP_POOL *pool;
+    unsigned int min;
+
+    if(this->pool) return &this->pool_env;
+
+    EnterCriticalSection(&this->cs);
+    if(!this->pool) {
+        if(!(pool = CreateThreadpool(NULL))) {
+            scheduler_resource_allocation_error e;
+
+            LeaveCriticalSection(&this->cs);
+            scheduler_resource_allocation_error_ctor_name(&e, NULL,
+                    HRESULT_FROM_WIN32(GetLastError()));
+            _CxxThrowException(&e, &scheduler_resource_allocation_error_exception_type);
+        }
+
+        min = SchedulerPolicy_GetPolicyValue(&this->policy, MinConcurrency);
+        if(min > this->virt_proc_no) min = this->virt_proc_no;
+        SetThreadpoolThreadMaximum(pool, this->virt_proc_no);
+        SetThreadpoolThreadMinimum(pool, min);
+
+        memset(&this->pool_env, 0, sizeof(this->pool_env));
+        this->pool_env.Version = 1;
+        this->pool_env.Pool = pool;
+        InterlockedExchangePointer((void**)&this->pool, pool);
+    }
+    LeaveCriticalSection(&this->cs);
+    return &this->pool_env;
+}
+
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
 void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
 {
-    FIXME("(%p %p %p %p) stub\n", this, proc, data, placement);
+    schedule_task_arg *arg;
+    TP_CALLBACK_ENVIRON *env;
+
+    TRACE("(%p %p %p %p)\n", this, proc, data, placement);
+
+    if(placement) FIXME("ignoring placement %p\n", placement);
+
+    env = ThreadScheduler_get_pool_env(this);
+
+    arg = operator_new(sizeof(*arg));
+    arg->proc = proc;
+    arg->data = data;
+    arg->scheduler = this;
+    ThreadScheduler_Reference(this);
+
+    if(!TrySubmitThreadpoolCallback(schedule_task_proc, arg, env)) {
+        scheduler_resource_allocation_error e;
+
+        ThreadScheduler_Release(this);
+        operator_delete(arg);
+        scheduler_resource_allocation_error_ctor_name(&e, NULL,
+                HRESULT_FROM_WIN32(GetLastError()));
+        _CxxThrowException(&e, &scheduler_resource_allocation_error_exception_type);
+    }
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask, 12)
 void __thiscall ThreadScheduler_ScheduleTask(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data)
 {
-    FIXME("(%p %p %p) stub\n", this, proc, data);
+    TRACE("(%p %p %p)\n", this, proc, data);
+    ThreadScheduler_ScheduleTask_loc(this, proc, data, NULL);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_IsAvailableLocation, 8)
@@ -1278,6 +1368,7 @@ static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
 
     this->shutdown_count = this->shutdown_size = 0;
     this->shutdown_events = NULL;
+    this->pool = NULL;
 
     InitializeCriticalSection(&this->cs);
     this->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": ThreadScheduler");
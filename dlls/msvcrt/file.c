@@ -99,6 +99,7 @@ static char utf16_bom[2] = { 0xff, 0xfe };
 #define MSVCRT_FD_BLOCK_SIZE 32
 
 #define MSVCRT_INTERNAL_BUFSIZ 4096
+#define MSVCRT_MAX_BUFSIZ      0x10000
 
 /* ioinfo structure size is different in msvcrXX.dll's */
 typedef struct {
@@ -720,6 +721,25 @@ static BOOL msvcrt_alloc_buffer(FILE* file)
     return TRUE;
 }
 
+/* INTERNAL: Grow the stdio buffer of a file that is read sequentially */
+static void msvcrt_grow_buffer(FILE* file)
+{
+    char *buf;
+
+    /* the previous fill must have been mostly consumed */
+    if(!(file->_flag & _IOMYBUF) || file->_bufsiz >= MSVCRT_MAX_BUFSIZ
+            || file->_ptr - file->_base < file->_bufsiz / 2)
+        return;
+    if(get_ioinfo_nolock(file->_file)->wxflag & (WX_PIPE | WX_TTY))
+        return;
+
+    if(!(buf = malloc(file->_bufsiz * 2)))
+        return;
+    free(file->_base);
+    file->_ptr = file->_base = buf;
+    file->_bufsiz *= 2;
+}
+
 /* INTERNAL: Allocate temporary buffer for stdout and stderr */
 static BOOL add_std_buffer(FILE *file)
 {
@@ -2766,6 +2786,85 @@ static int read_utf8(ioinfo *fdinfo, wchar_t *buf, unsigned int count)
  * the file pointer on the \r character while getc() goes on to
  * the following \n
  */
+/* INTERNAL: Handle a \r at the end of a text mode read buffer, returns the new buffer length */
+static DWORD read_text_lookahead(ioinfo *fdinfo, char *bufstart, DWORD j, DWORD utf16)
+{
+    char lookahead[2];
+    DWORD len;
+
+    lookahead[1] = '\n';
+    if (ReadFile(fdinfo->handle, lookahead, 1+utf16, &len, NULL) && len)
+    {
+        if(lookahead[0]=='\n' && (!utf16 || lookahead[1]==0) && j==0)
+        {
+            bufstart[j++] = '\n';
+            if(utf16) bufstart[j++] = 0;
+        }
+        else
+        {
+            if(lookahead[0]!='\n' || (utf16 && lookahead[1]!=0))
+            {
+                bufstart[j++] = '\r';
+                if(utf16) bufstart[j++] = 0;
+            }
+
+            if (fdinfo->wxflag & (WX_PIPE | WX_TTY))
+            {
+                if (lookahead[0]=='\n' && (!utf16 || !lookahead[1]))
+                {
+                    bufstart[j++] = '\n';
+                    if (utf16) bufstart[j++] = 0;
+                }
+                else
+                {
+                    fdinfo->lookahead[0] = lookahead[0];
+                    fdinfo->lookahead[1] = lookahead[1];
+                }
+            }
+            else
+                SetFilePointer(fdinfo->handle, -1-utf16, NULL, FILE_CURRENT);
+        }
+    }
+    else
+    {
+        bufstart[j++] = '\r';
+        if(utf16) bufstart[j++] = 0;
+    }
+    return j;
+}
+
+/* INTERNAL: Strip \r before \n and stop at ^Z in a text mode buffer of single byte characters */
+static DWORD read_text_translate(ioinfo *fdinfo, char *bufstart, DWORD num_read)
+{
+    char *eof = memchr(bufstart, 0x1a, num_read), *cr;
+    DWORD end = eof ? eof - bufstart : num_read;
+    DWORD i = 0, j = 0, len;
+
+    /* copy the runs between carriage returns in bulk */
+    while (i < end)
+    {
+        cr = memchr(bufstart + i, '\r', end - i);
+        len = (cr ? cr - bufstart : end) - i;
+        if (j != i) memmove(bufstart + j, bufstart + i, len);
+        i += len;
+        j += len;
+        if (!cr) break;
+
+        if (i + 1 == num_read)
+            j = read_text_lookahead(fdinfo, bufstart, j, 0);
+        else if (bufstart[i + 1] != '\n')
+            bufstart[j++] = '\r';
+        i++;
+    }
+
+    if (eof)
+    {
+        fdinfo->wxflag |= WX_ATEOF;
+        TRACE(":^Z EOF %s\n", debugstr_an(bufstart, num_read));
+    }
+    return j;
+}
+
 static int read_i(int fd, ioinfo *fdinfo, void *buf, unsigned int count)
 {
     DWORD num_read, utf16;
@@ -2838,69 +2937,32 @@ static int read_i(int fd, ioinfo *fdinfo, void *buf, unsigned int count)
             else
                 fdinfo->wxflag &= ~WX_READNL;
 
-            for (i=0, j=0; i<num_read; i+=1+utf16)
+            if (!utf16)
+                num_read = read_text_translate(fdinfo, bufstart, num_read);
+            else
             {
-                /* in text mode, a ctrl-z signals EOF */
-                if (bufstart[i]==0x1a && (!utf16 || bufstart[i+1]==0))
-                {
-                    fdinfo->wxflag |= WX_ATEOF;
-                    TRACE(":^Z EOF %s\n",debugstr_an(buf,num_read));
-                    break;
-                }
-
-                /* in text mode, strip \r if followed by \n */
-                if (bufstart[i]=='\r' && (!utf16 || bufstart[i+1]==0) && i+1+utf16==num_read)
+                for (i=0, j=0; i<num_read; i+=1+utf16)
                 {
-                    char lookahead[2];
-                    DWORD len;
-
-                    lookahead[1] = '\n';
-                    if (ReadFile(fdinfo->handle, lookahead, 1+utf16, &len, NULL) && len)
+                    /* in text mode, a ctrl-z signals EOF */
+                    if (bufstart[i]==0x1a && (!utf16 || bufstart[i+1]==0))
                     {
-                        if(lookahead[0]=='\n' && (!utf16 || lookahead[1]==0) && j==0)
-                        {
-                            bufstart[j++] = '\n';
-                            if(utf16) bufstart[j++] = 0;
-                        }
-                        else
-                        {
-                            if(lookahead[0]!='\n' || (utf16 && lookahead[1]!=0))
-                            {
-                                bufstart[j++] = '\r';
-                                if(utf16) bufstart[j++] = 0;
-                            }
-
-                            if (fdinfo->wxflag & (WX_PIPE | WX_TTY))
-                            {
-                                if (lookahead[0]=='\n' && (!utf16 || !lookahead[1]))
-                                {
-                                    bufstart[j++] = '\n';
-                                    if (utf16) bufstart[j++] = 0;
-                                }
-                                else
-                                {
-                                    fdinfo->lookahead[0] = lookahead[0];
-                                    fdinfo->lookahead[1] = lookahead[1];
-                                }
-                            }
-                            else
-                                SetFilePointer(fdinfo->handle, -1-utf16, NULL, FILE_CURRENT);
-                        }
+                        fdinfo->wxflag |= WX_ATEOF;
+                        TRACE(":^Z EOF %s\n",debugstr_an(buf,num_read));
+                        break;
                     }
-                    else
+
+                    /* in text mode, strip \r if followed by \n */
+                    if (bufstart[i]=='\r' && (!utf16 || bufstart[i+1]==0) && i+1+utf16==num_read)
+                        j = read_text_lookahead(fdinfo, bufstart, j, utf16);
+                    else if((bufstart[i]!='\r' || (utf16 && bufstart[i+1]!=0))
+                            || (bufstart[i+1+utf16]!='\n' || (utf16 && bufstart[i+3]!=0)))
                     {
-                        bufstart[j++] = '\r';
-                        if(utf16) bufstart[j++] = 0;
+                        bufstart[j++] = bufstart[i];
+                        if(utf16) bufstart[j++] = bufstart[i+1];
                     }
                 }
-                else if((bufstart[i]!='\r' || (utf16 && bufstart[i+1]!=0))
-                        || (bufstart[i+1+utf16]!='\n' || (utf16 && bufstart[i+3]!=0)))
-                {
-                    bufstart[j++] = bufstart[i];
-                    if(utf16) bufstart[j++] = bufstart[i+1];
-                }
+                num_read = j;
             }
-            num_read = j;
         }
     }
     else
@@ -3707,6 +3769,7 @@ int CDECL _filbuf(FILE* file)
 
         return c;
     } else {
+        msvcrt_grow_buffer(file);
         file->_cnt = _read(file->_file, file->_base, file->_bufsiz);
         if(file->_cnt<=0) {
             file->_flag |= (file->_cnt == 0) ? _IOEOF : _IOERR;
@@ -3768,25 +3831,44 @@ char * CDECL fgets(char *s, int size, FILE* file)
 {
   int    cc = EOF;
   char * buf_start = s;
+  char * nl;
+  int    len;
 
   TRACE(":file(%p) fd (%d) str (%p) len (%d)\n",
 	file,file->_file,s,size);
 
   _lock_file(file);
 
-  while ((size >1) && (cc = _fgetc_nolock(file)) != EOF && cc != '\n')
+  while (size > 1)
+  {
+    /* copy up to the next newline straight from the buffer */
+    if (file->_cnt > 0)
     {
-      *s++ = (char)cc;
-      size --;
+      len = min(file->_cnt, size - 1);
+      if ((nl = memchr(file->_ptr, '\n', len)))
+        len = nl - file->_ptr + 1;
+      memcpy(s, file->_ptr, len);
+      file->_ptr += len;
+      file->_cnt -= len;
+      s += len;
+      size -= len;
+      if (nl) break;
+      continue;
     }
+
+    if ((cc = _filbuf(file)) == EOF)
+      break;
+    *s++ = cc;
+    size--;
+    if (cc == '\n')
+      break;
+  }
   if ((cc == EOF) && (s == buf_start)) /* If nothing read, return 0*/
   {
     TRACE(":nothing read\n");
     _unlock_file(file);
     return NULL;
   }
-  if ((cc != EOF) && (size > 1))
-    *s++ = cc;
   *s = '\0';
   TRACE(":got %s\n", debugstr_a(buf_start));
   _unlock_file(file);
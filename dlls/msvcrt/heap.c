@@ -53,6 +53,324 @@ static unsigned int MSVCRT_amblksiz = 16;
 /* FIXME - According to documentation it should be 480 bytes, at runtime default is 0 */
 static size_t MSVCRT_sbh_threshold = 0;
 
+/* Small blocks are carved out of 64k spans holding blocks of a single size
+ * class. Freed blocks are kept in per-thread caches and exchanged with the
+ * global free lists in batches, so most small allocations don't touch the
+ * heap lock. Such blocks can't be used with the Heap* functions on the
+ * _get_heap_handle() heap, so this is only enabled when WINE_CRT_SMALL_BLOCKS
+ * is set in the environment. */
+#define SMALL_BLOCK_ALIGN    16
+#define SMALL_BLOCK_CLASSES  16
+#define SMALL_BLOCK_MAX      (SMALL_BLOCK_CLASSES * SMALL_BLOCK_ALIGN)
+#define SMALL_BLOCK_FREE     0xffff
+#define SMALL_SPAN_SIZE      0x10000
+#define SMALL_ARENA_SIZE     0x400000
+#define SMALL_ARENA_MAX      64
+#define SMALL_CACHE_BATCH    32
+#define SMALL_CACHE_MAX      (2 * SMALL_CACHE_BATCH)
+
+struct small_span
+{
+    unsigned int class;       /* size class of the blocks */
+    unsigned int count;       /* number of blocks in the span */
+    unsigned int used;        /* number of blocks handed out so far */
+    unsigned int data_offset; /* offset of the first block */
+    WORD sizes[1];            /* requested size of each block, or SMALL_BLOCK_FREE */
+};
+
+struct small_bin
+{
+    void *head;
+    unsigned int count;
+};
+
+struct small_cache
+{
+    struct small_bin bins[SMALL_BLOCK_CLASSES];
+};
+
+static char *small_arenas[SMALL_ARENA_MAX];
+static LONG small_arena_count;
+static SIZE_T small_arena_used[SMALL_ARENA_MAX];
+static struct small_span *small_spans[SMALL_BLOCK_CLASSES];
+static struct small_bin small_free_bins[SMALL_BLOCK_CLASSES];
+static DWORD small_cache_tls = TLS_OUT_OF_INDEXES;
+
+static CRITICAL_SECTION small_cs;
+static CRITICAL_SECTION_DEBUG small_cs_debug =
+{
+    0, 0, &small_cs,
+    { &small_cs_debug.ProcessLocksList, &small_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": small_cs") }
+};
+static CRITICAL_SECTION small_cs = { &small_cs_debug, -1, 0, 0, 0, 0 };
+
+static inline unsigned int small_class(size_t size)
+{
+    return size ? (size - 1) / SMALL_BLOCK_ALIGN : 0;
+}
+
+static inline size_t small_class_size(unsigned int class)
+{
+    return (class + 1) * SMALL_BLOCK_ALIGN;
+}
+
+static inline struct small_span *small_block_span(const void *ptr)
+{
+    return (struct small_span *)((ULONG_PTR)ptr & ~(ULONG_PTR)(SMALL_SPAN_SIZE - 1));
+}
+
+static struct small_span *small_get_span(const void *ptr)
+{
+    LONG i, count = small_arena_count;
+    ULONG_PTR offset;
+
+    for (i = 0; i < count; i++)
+    {
+        offset = (const char *)ptr - small_arenas[i];
+        if (offset >= SMALL_ARENA_SIZE) continue;
+        if (offset >= small_arena_used[i]) return NULL;
+        return small_block_span(ptr);
+    }
+    return NULL;
+}
+
+static WORD *small_block_size(struct small_span *span, const void *ptr)
+{
+    size_t size = small_class_size(span->class);
+    ULONG_PTR offset = (const char *)ptr - ((char *)span + span->data_offset);
+
+    if (offset % size || offset / size >= span->used) return NULL;
+    return &span->sizes[offset / size];
+}
+
+static struct small_cache *small_get_cache(BOOL create)
+{
+    struct small_cache *cache;
+    DWORD err;
+
+    if (small_cache_tls == TLS_OUT_OF_INDEXES) return NULL;
+
+    err = GetLastError();  /* need to preserve last error */
+    if (!(cache = TlsGetValue(small_cache_tls)) && create &&
+            (cache = HeapAlloc(heap, HEAP_ZERO_MEMORY, sizeof(*cache))))
+        TlsSetValue(small_cache_tls, cache);
+    SetLastError(err);
+    return cache;
+}
+
+/* called with small_cs held */
+static struct small_span *small_alloc_span(unsigned int class)
+{
+    struct small_span *span;
+    char *base;
+    LONG i;
+
+    if (!small_arena_count || small_arena_used[small_arena_count - 1] == SMALL_ARENA_SIZE)
+    {
+        if (small_arena_count == SMALL_ARENA_MAX) return NULL;
+        if (!(base = VirtualAlloc(NULL, SMALL_ARENA_SIZE, MEM_RESERVE, PAGE_READWRITE)))
+            return NULL;
+        small_arenas[small_arena_count] = base;
+        InterlockedIncrement(&small_arena_count);
+    }
+
+    i = small_arena_count - 1;
+    base = small_arenas[i] + small_arena_used[i];
+    if (!VirtualAlloc(base, SMALL_SPAN_SIZE, MEM_COMMIT, PAGE_READWRITE)) return NULL;
+
+    span = (struct small_span *)base;
+    span->class = class;
+    span->used = 0;
+    span->count = (SMALL_SPAN_SIZE - offsetof(struct small_span, sizes) - SMALL_BLOCK_ALIGN) /
+            (small_class_size(class) + sizeof(WORD));
+    span->data_offset = (offsetof(struct small_span, sizes) + span->count * sizeof(WORD) +
+            SMALL_BLOCK_ALIGN - 1) & ~(SMALL_BLOCK_ALIGN - 1);
+    small_arena_used[i] += SMALL_SPAN_SIZE;
+    return span;
+}
+
+static inline void small_bin_push(struct small_bin *bin, void *ptr)
+{
+    *(void **)ptr = bin->head;
+    bin->head = ptr;
+    bin->count++;
+}
+
+static inline void *small_bin_pop(struct small_bin *bin)
+{
+    void *ret = bin->head;
+
+    bin->head = *(void **)ret;
+    bin->count--;
+    return ret;
+}
+
+static BOOL small_refill_bin(struct small_bin *bin, unsigned int class)
+{
+    struct small_bin *free_bin = &small_free_bins[class];
+    size_t size = small_class_size(class);
+    struct small_span *span;
+    char *ptr;
+
+    EnterCriticalSection(&small_cs);
+    while (bin->count < SMALL_CACHE_BATCH && free_bin->head)
+        small_bin_push(bin, small_bin_pop(free_bin));
+
+    while (bin->count < SMALL_CACHE_BATCH)
+    {
+        span = small_spans[class];
+        if (!span || span->used == span->count)
+        {
+            if (!(span = small_alloc_span(class))) break;
+            small_spans[class] = span;
+        }
+        span->sizes[span->used] = SMALL_BLOCK_FREE;
+        ptr = (char *)span + span->data_offset + span->used++ * size;
+        small_bin_push(bin, ptr);
+    }
+    LeaveCriticalSection(&small_cs);
+
+    return bin->head != NULL;
+}
+
+static void small_flush_bin(struct small_bin *bin, unsigned int class, unsigned int count)
+{
+    struct small_bin *free_bin = &small_free_bins[class];
+
+    EnterCriticalSection(&small_cs);
+    while (count-- && bin->head)
+        small_bin_push(free_bin, small_bin_pop(bin));
+    LeaveCriticalSection(&small_cs);
+}
+
+static void small_flush_cache(struct small_cache *cache)
+{
+    unsigned int i;
+
+    for (i = 0; i < SMALL_BLOCK_CLASSES; i++)
+        small_flush_bin(&cache->bins[i], i, cache->bins[i].count);
+}
+
+static void *small_alloc(DWORD flags, size_t size)
+{
+    unsigned int class = small_class(size);
+    struct small_cache *cache;
+    struct small_bin *bin;
+    void *ret;
+
+    if (!(cache = small_get_cache(TRUE))) return NULL;
+
+    bin = &cache->bins[class];
+    if (!bin->head && !small_refill_bin(bin, class)) return NULL;
+
+    ret = small_bin_pop(bin);
+    *small_block_size(small_block_span(ret), ret) = size;
+    if (flags & HEAP_ZERO_MEMORY) memset(ret, 0, size);
+    return ret;
+}
+
+static BOOL small_free(struct small_span *span, void *ptr)
+{
+    WORD *size = small_block_size(span, ptr);
+    struct small_cache *cache;
+    struct small_bin *bin;
+
+    if (!size || *size == SMALL_BLOCK_FREE)
+    {
+        WARN("invalid small block %p\n", ptr);
+        return FALSE;
+    }
+    *size = SMALL_BLOCK_FREE;
+
+    /* don't create a cache for threads that only free, e.g. while detaching */
+    if (!(cache = small_get_cache(FALSE)))
+    {
+        EnterCriticalSection(&small_cs);
+        small_bin_push(&small_free_bins[span->class], ptr);
+        LeaveCriticalSection(&small_cs);
+        return TRUE;
+    }
+
+    bin = &cache->bins[span->class];
+    small_bin_push(bin, ptr);
+    if (bin->count > SMALL_CACHE_MAX)
+        small_flush_bin(bin, span->class, SMALL_CACHE_BATCH);
+    return TRUE;
+}
+
+static size_t small_size(struct small_span *span, void *ptr)
+{
+    WORD *size = small_block_size(span, ptr);
+
+    if (!size || *size == SMALL_BLOCK_FREE) return ~(size_t)0;
+    return *size;
+}
+
+static void* msvcrt_heap_alloc(DWORD flags, size_t size);
+
+static void *small_realloc(struct small_span *span, DWORD flags, void *ptr, size_t size)
+{
+    WORD *old_size = small_block_size(span, ptr);
+    void *ret;
+
+    if (!old_size || *old_size == SMALL_BLOCK_FREE)
+    {
+        WARN("invalid small block %p\n", ptr);
+        return NULL;
+    }
+
+    if (size <= small_class_size(span->class))
+    {
+        *old_size = size;
+        return ptr;
+    }
+    if (flags & HEAP_REALLOC_IN_PLACE_ONLY) return NULL;
+
+    if (!(ret = msvcrt_heap_alloc(flags, size))) return NULL;
+    memcpy(ret, ptr, *old_size);
+    small_free(span, ptr);
+    return ret;
+}
+
+/* Reports the small blocks in use after next->_pentry, called with small_cs held.
+ * Free small blocks are linked in the free lists and are not reported. */
+static int small_heapwalk(_HEAPINFO *next)
+{
+    struct small_span *span, *start = NULL;
+    unsigned int idx = 0;
+    char *ptr;
+    LONG i;
+
+    if (next->_pentry && (start = small_get_span(next->_pentry)))
+        idx = ((char *)next->_pentry - ((char *)start + start->data_offset)) /
+                small_class_size(start->class) + 1;
+
+    for (i = 0; i < small_arena_count; i++)
+    {
+        for (ptr = small_arenas[i]; ptr < small_arenas[i] + small_arena_used[i]; ptr += SMALL_SPAN_SIZE)
+        {
+            span = (struct small_span *)ptr;
+            if (start)
+            {
+                if (span != start) continue;
+                start = NULL;
+            }
+            else idx = 0;
+
+            for (; idx < span->used; idx++)
+            {
+                if (span->sizes[idx] == SMALL_BLOCK_FREE) continue;
+                next->_pentry = (int *)(ptr + span->data_offset + idx * small_class_size(span->class));
+                next->_size = span->sizes[idx];
+                next->_useflag = _USEDENTRY;
+                return _HEAPOK;
+            }
+        }
+    }
+    return _HEAPEND;
+}
+
 static void* msvcrt_heap_alloc(DWORD flags, size_t size)
 {
     if(size < MSVCRT_sbh_threshold)
@@ -68,11 +386,22 @@ static void* msvcrt_heap_alloc(DWORD flags, size_t size)
         return memblock;
     }
 
+    if(size <= SMALL_BLOCK_MAX)
+    {
+        void *ret = small_alloc(flags, size);
+        if(ret) return ret;
+    }
+
     return HeapAlloc(heap, flags, size);
 }
 
 static void* msvcrt_heap_realloc(DWORD flags, void *ptr, size_t size)
 {
+    struct small_span *span;
+
+    if(ptr && (span = small_get_span(ptr)))
+        return small_realloc(span, flags, ptr, size);
+
     if(sb_heap && ptr && !HeapValidate(heap, 0, ptr))
     {
         /* TODO: move data to normal heap if it exceeds sbh_threshold limit */
@@ -105,6 +434,11 @@ static void* msvcrt_heap_realloc(DWORD flags, void *ptr, size_t size)
 
 static BOOL msvcrt_heap_free(void *ptr)
 {
+    struct small_span *span;
+
+    if(ptr && (span = small_get_span(ptr)))
+        return small_free(span, ptr);
+
     if(sb_heap && ptr && !HeapValidate(heap, 0, ptr))
     {
         void **saved = SAVED_PTR(ptr);
@@ -116,6 +450,11 @@ static BOOL msvcrt_heap_free(void *ptr)
 
 static size_t msvcrt_heap_size(void *ptr)
 {
+    struct small_span *span;
+
+    if(ptr && (span = small_get_span(ptr)))
+        return small_size(span, ptr);
+
     if(sb_heap && ptr && !HeapValidate(heap, 0, ptr))
     {
         void **saved = SAVED_PTR(ptr);
@@ -257,6 +596,11 @@ int CDECL _heapchk(void)
  */
 int CDECL _heapmin(void)
 {
+  struct small_cache *cache;
+
+  if (small_cache_tls != TLS_OUT_OF_INDEXES && (cache = TlsGetValue(small_cache_tls)))
+    small_flush_cache(cache);
+
   if (!HeapCompact( heap, 0 ) ||
           (sb_heap && !HeapCompact( sb_heap, 0 )))
   {
@@ -273,11 +617,21 @@ int CDECL _heapmin(void)
 int CDECL _heapwalk(_HEAPINFO *next)
 {
   PROCESS_HEAP_ENTRY phe;
+  int ret;
 
   if (sb_heap)
       FIXME("small blocks heap not supported\n");
 
   LOCK_HEAP;
+  if (next->_pentry && small_get_span(next->_pentry))
+  {
+    EnterCriticalSection(&small_cs);
+    ret = small_heapwalk(next);
+    LeaveCriticalSection(&small_cs);
+    UNLOCK_HEAP;
+    return ret;
+  }
+
   phe.lpData = next->_pentry;
   phe.cbData = next->_size;
   phe.wFlags = next->_useflag == _USEDENTRY ? PROCESS_HEAP_ENTRY_BUSY : 0;
@@ -294,9 +648,17 @@ int CDECL _heapwalk(_HEAPINFO *next)
   {
     if (!HeapWalk( heap, &phe ))
     {
-      UNLOCK_HEAP;
       if (GetLastError() == ERROR_NO_MORE_ITEMS)
-         return _HEAPEND;
+      {
+        /* continue with the small blocks */
+        next->_pentry = NULL;
+        EnterCriticalSection(&small_cs);
+        ret = small_heapwalk(next);
+        LeaveCriticalSection(&small_cs);
+        UNLOCK_HEAP;
+        return ret;
+      }
+      UNLOCK_HEAP;
       msvcrt_set_errno(GetLastError());
       if (!phe.lpData)
         return _HEAPBADBEGIN;
@@ -868,11 +1230,31 @@ int CDECL strncpy_s(char *dest, size_t numberOfElements,
 BOOL msvcrt_init_heap(void)
 {
     heap = HeapCreate(0, 0, 0);
+    if (GetEnvironmentVariableW(L"WINE_CRT_SMALL_BLOCKS", NULL, 0))
+        small_cache_tls = TlsAlloc();
     return heap != NULL;
 }
 
+void msvcrt_free_heap_cache(void)
+{
+    struct small_cache *cache;
+
+    if (small_cache_tls == TLS_OUT_OF_INDEXES || !(cache = TlsGetValue(small_cache_tls)))
+        return;
+
+    TlsSetValue(small_cache_tls, NULL);
+    small_flush_cache(cache);
+    HeapFree(heap, 0, cache);
+}
+
 void msvcrt_destroy_heap(void)
 {
+    LONG i;
+
+    if (small_cache_tls != TLS_OUT_OF_INDEXES)
+        TlsFree(small_cache_tls);
+    for (i = 0; i < small_arena_count; i++)
+        VirtualFree(small_arenas[i], 0, MEM_RELEASE);
     HeapDestroy(heap);
     if(sb_heap)
         HeapDestroy(sb_heap);
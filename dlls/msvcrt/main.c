@@ -153,6 +153,8 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 #if _MSVCR_VER >= 100 && _MSVCR_VER <= 120
     msvcrt_free_scheduler_thread();
 #endif
+    /* last, the functions above may still free memory */
+    msvcrt_free_heap_cache();
     TRACE("finished thread free\n");
     break;
   }
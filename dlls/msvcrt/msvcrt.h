@@ -35,6 +35,16 @@
 
 extern BOOL sse2_supported DECLSPEC_HIDDEN;
 
+#if defined(__i386__) || defined(__x86_64__)
+#define SSE2_TARGET __attribute__((target("sse2")))
+
+/* The SSE2 string functions only do aligned 16-byte loads, or unaligned loads
+ * that don't cross a page boundary, so they never read from a page the scalar
+ * versions wouldn't touch. */
+#define SSE2_PAGE_SIZE 0x1000
+#define sse2_page_end(p) (((ULONG_PTR)(p) & (SSE2_PAGE_SIZE - 1)) > SSE2_PAGE_SIZE - 16)
+#endif
+
 #define DBL80_MAX_10_EXP 4932
 #define DBL80_MIN_10_EXP -4951
 
@@ -230,6 +240,7 @@ extern void msvcrt_free_signals(void) DECLSPEC_HIDDEN;
 extern void msvcrt_free_popen_data(void) DECLSPEC_HIDDEN;
 extern BOOL msvcrt_init_heap(void) DECLSPEC_HIDDEN;
 extern void msvcrt_destroy_heap(void) DECLSPEC_HIDDEN;
+extern void msvcrt_free_heap_cache(void) DECLSPEC_HIDDEN;
 extern void msvcrt_init_clock(void) DECLSPEC_HIDDEN;
 
 #if _MSVCR_VER >= 100
@@ -28,6 +28,9 @@
 #include <limits.h>
 #include <locale.h>
 #include <float.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
 #include "msvcrt.h"
 #include "bnum.h"
 #include "winnls.h"
@@ -1507,14 +1510,142 @@ int CDECL _atoldbl(_LDOUBLE *value, char *str)
     return _atoldbl_l( (MSVCRT__LDOUBLE*)value, str, NULL );
 }
 
+#if defined(__i386__) || defined(__x86_64__)
+
+static SSE2_TARGET size_t sse2_strlen(const char *str)
+{
+    const char *p = (const char *)((ULONG_PTR)str & ~15);
+    const __m128i zero = _mm_setzero_si128();
+    DWORD mask, idx;
+
+    mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), zero));
+    mask >>= str - p;
+    if (BitScanForward(&idx, mask)) return idx;
+
+    for (;;)
+    {
+        p += 16;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), zero));
+        if (BitScanForward(&idx, mask)) return p + idx - str;
+    }
+}
+
+static SSE2_TARGET char *sse2_strchr(const char *str, char c)
+{
+    const char *p = (const char *)((ULONG_PTR)str & ~15);
+    const __m128i zero = _mm_setzero_si128(), needle = _mm_set1_epi8(c);
+    __m128i v = _mm_load_si128((const __m128i *)p);
+    DWORD mask, idx;
+
+    mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, zero), _mm_cmpeq_epi8(v, needle)));
+    mask &= 0xffff << (str - p);
+
+    while (!BitScanForward(&idx, mask))
+    {
+        p += 16;
+        v = _mm_load_si128((const __m128i *)p);
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, zero), _mm_cmpeq_epi8(v, needle)));
+    }
+    return p[idx] == c ? (char *)p + idx : NULL;
+}
+
+static SSE2_TARGET void *sse2_memchr(const void *ptr, unsigned char c, size_t n)
+{
+    const unsigned char *p = (const unsigned char *)((ULONG_PTR)ptr & ~15);
+    const __m128i needle = _mm_set1_epi8(c);
+    size_t len = n + ((const unsigned char *)ptr - p);
+    DWORD mask, idx;
+
+    if (!n) return NULL;
+    if (len < n) len = ~(size_t)0;
+
+    mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), needle));
+    mask &= 0xffff << ((const unsigned char *)ptr - p);
+
+    while (!BitScanForward(&idx, mask))
+    {
+        if (len <= 16) return NULL;
+        len -= 16;
+        p += 16;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), needle));
+    }
+    return idx < len ? (void *)(ULONG_PTR)(p + idx) : NULL;
+}
+
+static SSE2_TARGET int sse2_memcmp(const unsigned char *p1, const unsigned char *p2, size_t n)
+{
+    DWORD mask, idx;
+
+    for (; n >= 16; n -= 16, p1 += 16, p2 += 16)
+    {
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p1),
+                                                _mm_loadu_si128((const __m128i *)p2)));
+        if (BitScanForward(&idx, ~mask & 0xffff))
+            return p1[idx] < p2[idx] ? -1 : 1;
+    }
+    for (; n; n--, p1++, p2++)
+    {
+        if (*p1 < *p2) return -1;
+        if (*p1 > *p2) return 1;
+    }
+    return 0;
+}
+
+static SSE2_TARGET int sse2_strcmp(const unsigned char *str1, const unsigned char *str2)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v1, v2;
+    DWORD mask, idx;
+
+    for (;;)
+    {
+        if (sse2_page_end(str1) || sse2_page_end(str2))
+        {
+            if (!*str1 || *str1 != *str2) break;
+            str1++;
+            str2++;
+            continue;
+        }
+
+        v1 = _mm_loadu_si128((const __m128i *)str1);
+        v2 = _mm_loadu_si128((const __m128i *)str2);
+        mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2)) & 0xffff;
+        mask |= _mm_movemask_epi8(_mm_cmpeq_epi8(v1, zero));
+        if (BitScanForward(&idx, mask))
+        {
+            str1 += idx;
+            str2 += idx;
+            break;
+        }
+        str1 += 16;
+        str2 += 16;
+    }
+
+    if (*str1 > *str2) return 1;
+    if (*str1 < *str2) return -1;
+    return 0;
+}
+
+#endif
+
 /*********************************************************************
  *              strlen (MSVCRT.@)
  */
 size_t __cdecl strlen(const char *str)
 {
+#ifdef __x86_64__
+    return sse2_strlen(str);
+#else
     const char *s = str;
+
+#ifdef __i386__
+    if (sse2_supported)
+        return sse2_strlen(str);
+#endif
+
     while (*s) s++;
     return s - str;
+#endif
 }
 
 /******************************************************************
@@ -2682,6 +2813,13 @@ int __cdecl memcmp(const void *ptr1, const void *ptr2, size_t n)
 {
     const unsigned char *p1, *p2;
 
+#ifdef __x86_64__
+    return sse2_memcmp(ptr1, ptr2, n);
+#elif defined(__i386__)
+    if (sse2_supported)
+        return sse2_memcmp(ptr1, ptr2, n);
+#endif
+
     for (p1 = ptr1, p2 = ptr2; n; n--, p1++, p2++)
     {
         if (*p1 < *p2) return -1;
@@ -3150,6 +3288,13 @@ void *__cdecl memset(void *dst, int c, size_t n)
  */
 char* __cdecl strchr(const char *str, int c)
 {
+#ifdef __x86_64__
+    return sse2_strchr(str, c);
+#elif defined(__i386__)
+    if (sse2_supported)
+        return sse2_strchr(str, c);
+#endif
+
     do
     {
         if (*str == (char)c) return (char*)str;
@@ -3174,6 +3319,13 @@ void* __cdecl memchr(const void *ptr, int c, size_t n)
 {
     const unsigned char *p = ptr;
 
+#ifdef __x86_64__
+    return sse2_memchr(ptr, c, n);
+#elif defined(__i386__)
+    if (sse2_supported)
+        return sse2_memchr(ptr, c, n);
+#endif
+
     for (p = ptr; n; n--, p++) if (*p == (unsigned char)c) return (void *)(ULONG_PTR)p;
     return NULL;
 }
@@ -3183,6 +3335,13 @@ void* __cdecl memchr(const void *ptr, int c, size_t n)
  */
 int __cdecl strcmp(const char *str1, const char *str2)
 {
+#ifdef __x86_64__
+    return sse2_strcmp((const unsigned char *)str1, (const unsigned char *)str2);
+#elif defined(__i386__)
+    if (sse2_supported)
+        return sse2_strcmp((const unsigned char *)str1, (const unsigned char *)str2);
+#endif
+
     while (*str1 && *str1 == *str2) { str1++; str2++; }
     if ((unsigned char)*str1 > (unsigned char)*str2) return 1;
     if ((unsigned char)*str1 < (unsigned char)*str2) return -1;
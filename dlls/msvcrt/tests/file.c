@@ -562,6 +562,40 @@ static void test_readboundary(void)
   ok(strcmp(buf, rbuf) == 0,"CRLF on buffer boundary failure\n");
   }
 
+static void test_readlines(void)
+{
+    char line[64], expect[64];
+    long pos = 0;
+    FILE *fp;
+    int i, len;
+
+    fp = fopen("readlines.tst", "wt");
+    ok(fp != NULL, "fopen failed\n");
+    for (i = 0; i < 20000; i++)
+        fprintf(fp, "line %d%s\n", i, i % 7 ? "" : "\r");
+    fclose(fp);
+
+    fp = fopen("readlines.tst", "rt");
+    ok(fp != NULL, "fopen failed\n");
+    for (i = 0; i < 20000; i++)
+    {
+        len = sprintf(expect, "line %d%s\n", i, i % 7 ? "" : "\r");
+        if (!fgets(line, sizeof(line), fp))
+        {
+            ok(0, "fgets failed on line %d\n", i);
+            break;
+        }
+        ok(!strcmp(line, expect), "line %d: got %s\n", i, wine_dbgstr_a(line));
+        pos += len + 1;
+        if (i % 1000 == 999)
+            ok(ftell(fp) == pos, "line %d: ftell returned %ld, expected %ld\n", i, ftell(fp), pos);
+    }
+    ok(!fgets(line, sizeof(line), fp), "fgets succeeded at EOF\n");
+    ok(feof(fp), "feof not set\n");
+    fclose(fp);
+    unlink("readlines.tst");
+}
+
 static void test_fgetc( void )
 {
   char* tempf;
@@ -2897,6 +2931,7 @@ START_TEST(file)
     test_readmode(FALSE); /* binary mode */
     test_readmode(TRUE);  /* ascii mode */
     test_readboundary();
+    test_readlines();
     test_fgetc();
     test_fputc();
     test_flsbuf();
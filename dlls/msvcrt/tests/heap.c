@@ -20,6 +20,7 @@
 
 #include <stdlib.h>
 #include <malloc.h>
+#include <process.h>
 #include <errno.h>
 #include "wine/test.h"
 
@@ -30,6 +31,7 @@ static void * (__cdecl *p_aligned_realloc)(void*,size_t,size_t);
 static void * (__cdecl *p_aligned_offset_realloc)(void*,size_t,size_t,size_t);
 static int (__cdecl *p__set_sbh_threshold)(size_t);
 static size_t (__cdecl *p__get_sbh_threshold)(void);
+static intptr_t (__cdecl *p_get_heap_handle)(void);
 
 static void test_aligned_malloc(unsigned int size, unsigned int alignment)
 {
@@ -494,9 +496,214 @@ static void test_calloc(void)
     free(ptr);
 }
 
+static void test_msize(void)
+{
+    char *mem[300];
+    size_t size;
+    void *ptr;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(mem); i++)
+    {
+        mem[i] = malloc(i);
+        ok(mem[i] != NULL, "malloc(%d) failed\n", i);
+        memset(mem[i], i, i);
+    }
+    for (i = 0; i < ARRAY_SIZE(mem); i++)
+    {
+        size = _msize(mem[i]);
+        ok(size == i, "_msize returned %Iu, expected %d\n", size, i);
+        free(mem[i]);
+    }
+
+    mem[0] = malloc(10);
+    memcpy(mem[0], "0123456789", 10);
+    mem[0] = realloc(mem[0], 12);
+    ok(mem[0] != NULL, "realloc failed\n");
+    size = _msize(mem[0]);
+    ok(size == 12, "_msize returned %Iu\n", size);
+    mem[0] = realloc(mem[0], 1000);
+    ok(mem[0] != NULL, "realloc failed\n");
+    ok(!memcmp(mem[0], "0123456789", 10), "data not preserved\n");
+    size = _msize(mem[0]);
+    ok(size == 1000, "_msize returned %Iu\n", size);
+    free(mem[0]);
+
+    mem[0] = malloc(20);
+    ptr = _expand(mem[0], 5);
+    ok(ptr == mem[0], "_expand returned %p, expected %p\n", ptr, mem[0]);
+    size = _msize(mem[0]);
+    ok(size == 5, "_msize returned %Iu\n", size);
+    free(mem[0]);
+
+    /* blocks can be used with the Heap* functions */
+    p_get_heap_handle = (void *)GetProcAddress(GetModuleHandleA("msvcrt.dll"), "_get_heap_handle");
+    if (!p_get_heap_handle)
+    {
+        win_skip("_get_heap_handle not available\n");
+        return;
+    }
+    mem[0] = malloc(10);
+    size = HeapSize((HANDLE)p_get_heap_handle(), 0, mem[0]);
+    ok(size == 10, "HeapSize returned %Iu\n", size);
+    ok(HeapFree((HANDLE)p_get_heap_handle(), 0, mem[0]), "HeapFree failed\n");
+}
+
+static unsigned __stdcall free_blocks_thread(void *arg)
+{
+    char **mem = arg;
+    int i;
+
+    for (i = 0; i < 256; i++)
+        free(mem[i]);
+    for (i = 0; i < 256; i++)
+    {
+        mem[i] = malloc(i + 1);
+        memset(mem[i], 0xcc, i + 1);
+    }
+    return 0;
+}
+
+/* run in a child process with WINE_CRT_SMALL_BLOCKS set */
+static void test_small_blocks_child(void)
+{
+    char *mem[256], *ptr;
+    _HEAPINFO hi;
+    HANDLE thread;
+    size_t size;
+    BOOL found;
+    int i, j, ret;
+
+    for (j = 0; j < 4; j++)
+    {
+        for (i = 0; i < ARRAY_SIZE(mem); i++)
+        {
+            mem[i] = malloc(i + 1);
+            ok(mem[i] != NULL, "malloc(%d) failed\n", i + 1);
+            ok(!((UINT_PTR)mem[i] & 0xf), "incorrect alignment %p\n", mem[i]);
+            memset(mem[i], i, i + 1);
+        }
+        for (i = 0; i < ARRAY_SIZE(mem); i++)
+        {
+            size = _msize(mem[i]);
+            ok(size == i + 1, "_msize returned %Iu, expected %d\n", size, i + 1);
+            ok(mem[i][0] == (char)i && mem[i][i] == (char)i, "block %d overwritten\n", i);
+        }
+        /* free half of them, in a different order on each pass */
+        for (i = j & 1; i < ARRAY_SIZE(mem); i += 2)
+        {
+            free(mem[i]);
+            mem[i] = NULL;
+        }
+        for (i = 0; i < ARRAY_SIZE(mem); i++)
+            free(mem[i]);
+    }
+
+    ptr = malloc(10);
+    memcpy(ptr, "0123456789", 10);
+    ptr = realloc(ptr, 16);
+    ok(ptr != NULL, "realloc failed\n");
+    ok(!memcmp(ptr, "0123456789", 10), "data not preserved\n");
+    size = _msize(ptr);
+    ok(size == 16, "_msize returned %Iu\n", size);
+    ptr = realloc(ptr, 100);
+    ok(ptr != NULL, "realloc failed\n");
+    ok(!memcmp(ptr, "0123456789", 10), "data not preserved\n");
+    size = _msize(ptr);
+    ok(size == 100, "_msize returned %Iu\n", size);
+    ptr = realloc(ptr, 1000);
+    ok(ptr != NULL, "realloc failed\n");
+    ok(!memcmp(ptr, "0123456789", 10), "data not preserved\n");
+    ptr = realloc(ptr, 5);
+    ok(ptr != NULL, "realloc failed\n");
+    ok(!memcmp(ptr, "01234", 5), "data not preserved\n");
+    free(ptr);
+
+    mem[0] = malloc(40);
+    ptr = _expand(mem[0], 20);
+    ok(ptr == mem[0], "_expand returned %p, expected %p\n", ptr, mem[0]);
+    size = _msize(mem[0]);
+    ok(size == 20, "_msize returned %Iu\n", size);
+    free(mem[0]);
+
+    /* blocks freed by another thread, which allocates new ones freed here */
+    for (i = 0; i < ARRAY_SIZE(mem); i++)
+        mem[i] = malloc(i + 1);
+    thread = (HANDLE)_beginthreadex(NULL, 0, free_blocks_thread, mem, 0, NULL);
+    ok(thread != NULL, "_beginthreadex failed (%d)\n", errno);
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+    for (i = 0; i < ARRAY_SIZE(mem); i++)
+    {
+        size = _msize(mem[i]);
+        ok(size == i + 1, "_msize returned %Iu, expected %d\n", size, i + 1);
+        ok((unsigned char)mem[i][i] == 0xcc, "block %d overwritten\n", i);
+        free(mem[i]);
+    }
+    for (i = 0; i < ARRAY_SIZE(mem); i++)
+    {
+        mem[i] = malloc(i + 1);
+        ok(mem[i] != NULL, "malloc(%d) failed\n", i + 1);
+    }
+    for (i = 0; i < ARRAY_SIZE(mem); i++)
+        free(mem[i]);
+
+    ptr = malloc(24);
+    memset(&hi, 0, sizeof(hi));
+    found = FALSE;
+    while ((ret = _heapwalk(&hi)) == _HEAPOK)
+    {
+        if (hi._pentry != (int *)ptr) continue;
+        ok(hi._useflag == _USEDENTRY, "got flags %d\n", hi._useflag);
+        ok(hi._size >= 24, "got size %Iu\n", hi._size);
+        found = TRUE;
+    }
+    ok(ret == _HEAPEND, "_heapwalk returned %d\n", ret);
+    ok(found, "block %p not found\n", ptr);
+
+    free(ptr);
+    memset(&hi, 0, sizeof(hi));
+    while ((ret = _heapwalk(&hi)) == _HEAPOK)
+        if (hi._pentry == (int *)ptr)
+            ok(hi._useflag != _USEDENTRY, "freed block %p reported as used\n", ptr);
+    ok(ret == _HEAPEND, "_heapwalk returned %d\n", ret);
+}
+
+static void test_small_blocks(const char *argv0)
+{
+    PROCESS_INFORMATION proc;
+    STARTUPINFOA startup;
+    char cmdline[MAX_PATH + 32];
+    BOOL ret;
+
+    SetEnvironmentVariableA("WINE_CRT_SMALL_BLOCKS", "1");
+    sprintf(cmdline, "\"%s\" heap small_blocks", argv0);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &proc);
+    ok(ret, "CreateProcess failed: %u\n", GetLastError());
+    SetEnvironmentVariableA("WINE_CRT_SMALL_BLOCKS", NULL);
+    if (!ret) return;
+    wait_child_process(proc.hProcess);
+    CloseHandle(proc.hProcess);
+    CloseHandle(proc.hThread);
+}
+
 START_TEST(heap)
 {
+    char **arg_v;
     void *mem;
+    int arg_c;
+
+    arg_c = winetest_get_mainargs(&arg_v);
+    if (arg_c >= 3)
+    {
+        if (!strcmp(arg_v[2], "small_blocks"))
+            test_small_blocks_child();
+        else
+            ok(0, "invalid argument '%s'\n", arg_v[2]);
+        return;
+    }
 
     mem = malloc(0);
     ok(mem != NULL, "memory not allocated for size 0\n");
@@ -519,4 +726,6 @@ START_TEST(heap)
     test_aligned();
     test_sbheap();
     test_calloc();
+    test_msize();
+    test_small_blocks(arg_v[0]);
 }
@@ -4477,6 +4477,82 @@ static void test_wcsncpy(void)
             wine_dbgstr_wn(dst, ARRAY_SIZE(dst)));
 }
 
+static void test_page_boundary(void)
+{
+    size_t (__cdecl *p_strlen)(const char *);
+    char* (__cdecl *p_strchr)(const char *, int);
+    void* (__cdecl *p_memchr)(const void *, int, size_t);
+    int (__cdecl *p_memcmp)(const void *, const void *, size_t);
+    size_t (__cdecl *p_wcslen)(const wchar_t *);
+    int (__cdecl *p_wcscmp)(const wchar_t *, const wchar_t *);
+    char *page, *end, *str, *ptr;
+    wchar_t *wstr, wbuf[64];
+    char buf[64];
+    DWORD old_prot;
+    size_t len;
+    int i, ret;
+
+    p_strlen = (void *)GetProcAddress(hMsvcrt, "strlen");
+    p_strchr = (void *)GetProcAddress(hMsvcrt, "strchr");
+    p_memchr = (void *)GetProcAddress(hMsvcrt, "memchr");
+    p_memcmp = (void *)GetProcAddress(hMsvcrt, "memcmp");
+    p_wcslen = (void *)GetProcAddress(hMsvcrt, "wcslen");
+    p_wcscmp = (void *)GetProcAddress(hMsvcrt, "wcscmp");
+
+    page = VirtualAlloc(NULL, 0x2000, MEM_COMMIT, PAGE_READWRITE);
+    ok(page != NULL, "VirtualAlloc failed\n");
+    VirtualProtect(page + 0x1000, 0x1000, PAGE_NOACCESS, &old_prot);
+    end = page + 0x1000;
+
+    for (i = 0; i < 40; i++)
+    {
+        str = end - i - 1;
+        memset(str, 'a', i);
+        str[i] = 0;
+        memset(buf, 'a', i);
+        buf[i] = 0;
+
+        len = p_strlen(str);
+        ok(len == i, "%d: strlen returned %Iu\n", i, len);
+        ptr = p_strchr(str, 'b');
+        ok(!ptr, "%d: strchr returned %p\n", i, ptr);
+        ptr = p_strchr(str, 0);
+        ok(ptr == str + i, "%d: strchr returned %p, expected %p\n", i, ptr, str + i);
+        ptr = p_memchr(str, 0, i + 1);
+        ok(ptr == str + i, "%d: memchr returned %p, expected %p\n", i, ptr, str + i);
+        ptr = p_memchr(str, 'b', i + 1);
+        ok(!ptr, "%d: memchr returned %p\n", i, ptr);
+        ret = p_strcmp(str, buf);
+        ok(!ret, "%d: strcmp returned %d\n", i, ret);
+        ret = p_memcmp(str, buf, i + 1);
+        ok(!ret, "%d: memcmp returned %d\n", i, ret);
+        if (i)
+        {
+            buf[i - 1] = 'b';
+            ret = p_strcmp(str, buf);
+            ok(ret == -1, "%d: strcmp returned %d\n", i, ret);
+            ret = p_memcmp(buf, str, i);
+            ok(ret > 0, "%d: memcmp returned %d\n", i, ret);
+        }
+
+        wstr = (wchar_t *)end - i - 1;
+        for (len = 0; len < i; len++) wstr[len] = wbuf[len] = 0x8000 + len;
+        wstr[i] = wbuf[i] = 0;
+        len = p_wcslen(wstr);
+        ok(len == i, "%d: wcslen returned %Iu\n", i, len);
+        ret = p_wcscmp(wstr, wbuf);
+        ok(!ret, "%d: wcscmp returned %d\n", i, ret);
+        if (i)
+        {
+            wbuf[0] = 1;
+            ret = p_wcscmp(wstr, wbuf);
+            ok(ret > 0, "%d: wcscmp returned %d\n", i, ret);
+        }
+    }
+
+    VirtualFree(page, 0, MEM_RELEASE);
+}
+
 START_TEST(string)
 {
     char mem[100];
@@ -4633,4 +4709,5 @@ START_TEST(string)
     test_SpecialCasing();
     test__mbbtype();
     test_wcsncpy();
+    test_page_boundary();
 }
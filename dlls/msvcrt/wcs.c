@@ -26,6 +26,9 @@
 #include <assert.h>
 #include <wchar.h>
 #include <wctype.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
 #include "msvcrt.h"
 #include "winnls.h"
 #include "wtypes.h"
@@ -1863,11 +1866,75 @@ int WINAPIV _swprintf_p_l(wchar_t *buffer, size_t length,
     return r;
 }
 
+#if defined(__i386__) || defined(__x86_64__)
+
+static SSE2_TARGET size_t sse2_wcslen(const wchar_t *str)
+{
+    const char *p = (const char *)((ULONG_PTR)str & ~15);
+    const __m128i zero = _mm_setzero_si128();
+    DWORD mask, idx;
+
+    mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_load_si128((const __m128i *)p), zero));
+    mask >>= (const char *)str - p;
+    if (BitScanForward(&idx, mask)) return idx / sizeof(wchar_t);
+
+    for (;;)
+    {
+        p += 16;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_load_si128((const __m128i *)p), zero));
+        if (BitScanForward(&idx, mask)) return (p + idx - (const char *)str) / sizeof(wchar_t);
+    }
+}
+
+static SSE2_TARGET int sse2_wcscmp(const wchar_t *str1, const wchar_t *str2)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v1, v2;
+    DWORD mask, idx;
+
+    for (;;)
+    {
+        if (sse2_page_end(str1) || sse2_page_end(str2))
+        {
+            if (!*str1 || *str1 != *str2) break;
+            str1++;
+            str2++;
+            continue;
+        }
+
+        v1 = _mm_loadu_si128((const __m128i *)str1);
+        v2 = _mm_loadu_si128((const __m128i *)str2);
+        mask = ~_mm_movemask_epi8(_mm_cmpeq_epi16(v1, v2)) & 0xffff;
+        mask |= _mm_movemask_epi8(_mm_cmpeq_epi16(v1, zero));
+        if (BitScanForward(&idx, mask))
+        {
+            str1 += idx / sizeof(wchar_t);
+            str2 += idx / sizeof(wchar_t);
+            break;
+        }
+        str1 += 16 / sizeof(wchar_t);
+        str2 += 16 / sizeof(wchar_t);
+    }
+
+    if (*str1 < *str2) return -1;
+    if (*str1 > *str2) return 1;
+    return 0;
+}
+
+#endif
+
 /*********************************************************************
  *              wcscmp (MSVCRT.@)
  */
 int CDECL wcscmp(const wchar_t *str1, const wchar_t *str2)
 {
+#ifdef __x86_64__
+    return sse2_wcscmp(str1, str2);
+#elif defined(__i386__)
+    if (sse2_supported)
+        return sse2_wcscmp(str1, str2);
+#endif
+
     while (*str1 && (*str1 == *str2))
     {
         str1++;
@@ -2877,6 +2944,16 @@ wchar_t* CDECL wcsrchr(const wchar_t *str, wchar_t ch)
 size_t CDECL wcslen(const wchar_t *str)
 {
     const wchar_t *s = str;
+
+#if defined(__i386__) || defined(__x86_64__)
+    /* the aligned loads need wchar_t aligned strings */
+#ifdef __i386__
+    if (sse2_supported)
+#endif
+    if (!((ULONG_PTR)str & 1))
+        return sse2_wcslen(str);
+#endif
+
     while (*s) s++;
     return s - str;
 }
@@ -306,6 +306,22 @@ static RTL_CRITICAL_SECTION_DEBUG dynamic_unwind_debug =
 };
 static RTL_CRITICAL_SECTION dynamic_unwind_section = { &dynamic_unwind_debug, -1, 0, 0, 0, 0 };
 
+/* process-wide cache of successful function table lookups, indexed by pc */
+#define FUNCTION_CACHE_SIZE 1024  /* must be a power of 2 */
+
+struct function_cache_entry
+{
+    LONG                  seq;         /* odd while the entry is being updated */
+    LONG                  generation;  /* value of function_cache_generation at lookup time */
+    ULONG_PTR             pc;
+    ULONG_PTR             base;
+    RUNTIME_FUNCTION     *func;
+    LDR_DATA_TABLE_ENTRY *module;
+};
+
+static struct function_cache_entry function_cache[FUNCTION_CACHE_SIZE];
+static LONG function_cache_generation;  /* incremented when cached entries may have become stale */
+
 static ULONG_PTR get_runtime_function_end( RUNTIME_FUNCTION *func, ULONG_PTR addr )
 {
 #ifdef __x86_64__
@@ -344,6 +360,55 @@ static ULONG_PTR get_runtime_function_end( RUNTIME_FUNCTION *func, ULONG_PTR add
 #endif
 }
 
+static inline struct function_cache_entry *get_function_cache_entry( ULONG_PTR pc )
+{
+    return &function_cache[(pc ^ (pc >> 10)) & (FUNCTION_CACHE_SIZE - 1)];
+}
+
+/* look up a pc in the function cache, without taking any lock */
+static BOOL get_cached_function_info( ULONG_PTR pc, ULONG_PTR *base, RUNTIME_FUNCTION **func,
+                                      LDR_DATA_TABLE_ENTRY **module )
+{
+    struct function_cache_entry *entry = get_function_cache_entry( pc );
+    LONG seq = *(volatile LONG *)&entry->seq;
+
+    if (seq & 1) return FALSE;
+    MemoryBarrier();
+    if (entry->pc != pc || entry->generation != *(volatile LONG *)&function_cache_generation) return FALSE;
+    *base = entry->base;
+    *func = entry->func;
+    *module = entry->module;
+    MemoryBarrier();
+    return *(volatile LONG *)&entry->seq == seq;
+}
+
+/* store a lookup result in the function cache; give up if another thread is updating the entry */
+static void set_cached_function_info( ULONG_PTR pc, LONG generation, ULONG_PTR base, RUNTIME_FUNCTION *func,
+                                      LDR_DATA_TABLE_ENTRY *module )
+{
+    struct function_cache_entry *entry = get_function_cache_entry( pc );
+    LONG seq = *(volatile LONG *)&entry->seq;
+
+    if ((seq & 1) || InterlockedCompareExchange( &entry->seq, seq + 1, seq ) != seq) return;
+    entry->generation = generation;
+    entry->pc         = pc;
+    entry->base       = base;
+    entry->func       = func;
+    entry->module     = module;
+    InterlockedExchange( &entry->seq, seq + 2 );
+}
+
+/**********************************************************************
+ *           flush_function_info_cache
+ *
+ * Invalidate the cached lookups, called when a module or a function table goes away.
+ */
+void flush_function_info_cache(void)
+{
+    InterlockedIncrement( &function_cache_generation );
+}
+
+
 /**********************************************************************
  *              RtlAddFunctionTable   (NTDLL.@)
  */
@@ -487,6 +552,7 @@ void WINAPI RtlDeleteGrowableFunctionTable( void *table )
     }
     RtlLeaveCriticalSection( &dynamic_unwind_section );
 
+    if (to_free) flush_function_info_cache();
     RtlFreeHeap( GetProcessHeap(), 0, to_free );
 }
 
@@ -514,6 +580,7 @@ BOOLEAN CDECL RtlDeleteFunctionTable( RUNTIME_FUNCTION *table )
 
     if (!to_free) return FALSE;
 
+    flush_function_info_cache();
     RtlFreeHeap( GetProcessHeap(), 0, to_free );
     return TRUE;
 }
@@ -561,8 +628,12 @@ RUNTIME_FUNCTION *lookup_function_info( ULONG_PTR pc, ULONG_PTR *base, LDR_DATA_
 {
     RUNTIME_FUNCTION *func = NULL;
     struct dynamic_unwind_entry *entry;
+    LONG generation;
     ULONG size;
 
+    if (get_cached_function_info( pc, base, &func, module )) return func;
+    generation = *(volatile LONG *)&function_cache_generation;
+
     /* PE module or wine module */
     if (!LdrFindEntryForAddress( (void *)pc, module ))
     {
@@ -572,6 +643,7 @@ RUNTIME_FUNCTION *lookup_function_info( ULONG_PTR pc, ULONG_PTR *base, LDR_DATA_
         {
             /* lookup in function table */
             func = find_function_info( pc, (ULONG_PTR)(*module)->DllBase, func, size/sizeof(*func) );
+            if (func) set_cached_function_info( pc, generation, *base, func, *module );
         }
     }
     else
@@ -587,8 +659,8 @@ RUNTIME_FUNCTION *lookup_function_info( ULONG_PTR pc, ULONG_PTR *base, LDR_DATA_
                 /* use callback or lookup in function table */
                 if (entry->callback)
                     func = entry->callback( pc, entry->context );
-                else
-                    func = find_function_info( pc, entry->base, entry->table, entry->count );
+                else if ((func = find_function_info( pc, entry->base, entry->table, entry->count )))
+                    set_cached_function_info( pc, generation, *base, func, NULL );
                 break;
             }
         }
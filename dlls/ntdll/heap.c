@@ -715,6 +715,172 @@ static void HEAP_ShrinkBlock(SUBHEAP *subheap, ARENA_INUSE *pArena, SIZE_T size)
 }
 
 
+/* allocation profiling, enabled with WINEHEAPPROFILE=<output file>[,<sampling interval in bytes>] */
+
+#define PROFILE_MAX_FRAMES   32
+#define PROFILE_HASH_SIZE    4096
+#define PROFILE_DEFAULT_RATE (512 * 1024)
+
+struct profile_stack
+{
+    struct profile_stack *next;
+    HEAP                 *heap;          /* heap the allocations were made from */
+    ULONG                 hash;
+    USHORT                depth;
+    SIZE_T                alloc_count;   /* sampled allocations made from this stack */
+    SIZE_T                alloc_bytes;
+    SIZE_T                live_count;    /* sampled allocations that are not freed yet */
+    SIZE_T                live_bytes;
+    void                 *frames[1];
+};
+
+struct profile_block
+{
+    struct profile_block *next;
+    const void           *ptr;
+    SIZE_T                size;
+    struct profile_stack *stack;
+};
+
+static struct
+{
+    ULONG                 rate;          /* sampling interval in bytes, 0 if profiling is disabled */
+    LONGLONG              bytes;         /* running count of allocated bytes */
+    LONG                  live;          /* number of tracked blocks */
+    HANDLE                heap;          /* private heap for the profile data, not profiled itself */
+    UNICODE_STRING        file;          /* output file name prefix */
+    struct profile_stack *stacks[PROFILE_HASH_SIZE];
+    struct profile_block *blocks[PROFILE_HASH_SIZE];
+} profile;
+
+static RTL_CRITICAL_SECTION profile_section;
+static RTL_CRITICAL_SECTION_DEBUG profile_section_debug =
+{
+    0, 0, &profile_section,
+    { &profile_section_debug.ProcessLocksList, &profile_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": profile_section") }
+};
+static RTL_CRITICAL_SECTION profile_section = { &profile_section_debug, -1, 0, 0, 0, 0 };
+
+static inline unsigned int profile_block_hash( const void *ptr )
+{
+    return ((ULONG_PTR)ptr / ALIGNMENT) % PROFILE_HASH_SIZE;
+}
+
+/* sample the allocation that crosses each multiple of the sampling interval */
+static inline BOOL profile_sample( SIZE_T size )
+{
+    LONGLONG prev;
+
+    if (size >= profile.rate) return TRUE;
+    do prev = profile.bytes;
+    while (InterlockedCompareExchange64( &profile.bytes, prev + size, prev ) != prev);
+    return (ULONGLONG)prev % profile.rate + size >= profile.rate;
+}
+
+static void profile_alloc( HEAP *heap, const void *ptr, SIZE_T size )
+{
+    void *frames[PROFILE_MAX_FRAMES];
+    struct profile_stack *stack;
+    struct profile_block *block;
+    unsigned int index;
+    USHORT depth;
+    ULONG hash;
+
+    if (heap == profile.heap || !profile_sample( size )) return;
+
+    depth = RtlCaptureStackBackTrace( 1, PROFILE_MAX_FRAMES, frames, &hash );
+    hash ^= (ULONG_PTR)heap / ALIGNMENT;
+    index = hash % PROFILE_HASH_SIZE;
+
+    RtlEnterCriticalSection( &profile_section );
+
+    for (stack = profile.stacks[index]; stack; stack = stack->next)
+        if (stack->hash == hash && stack->heap == heap && stack->depth == depth &&
+            !memcmp( stack->frames, frames, depth * sizeof(*frames) )) break;
+
+    if (!stack)
+    {
+        if (!(stack = RtlAllocateHeap( profile.heap, HEAP_ZERO_MEMORY,
+                                       FIELD_OFFSET( struct profile_stack, frames[depth] ) ))) goto done;
+        stack->heap = heap;
+        stack->hash = hash;
+        stack->depth = depth;
+        memcpy( stack->frames, frames, depth * sizeof(*frames) );
+        stack->next = profile.stacks[index];
+        profile.stacks[index] = stack;
+    }
+    stack->alloc_count++;
+    stack->alloc_bytes += size;
+
+    if (!(block = RtlAllocateHeap( profile.heap, 0, sizeof(*block) ))) goto done;
+    block->ptr = ptr;
+    block->size = size;
+    block->stack = stack;
+    index = profile_block_hash( ptr );
+    block->next = profile.blocks[index];
+    profile.blocks[index] = block;
+    stack->live_count++;
+    stack->live_bytes += size;
+    InterlockedIncrement( &profile.live );
+
+done:
+    RtlLeaveCriticalSection( &profile_section );
+}
+
+/* must be called before the block is released, so that its address cannot be reused meanwhile */
+static void profile_free( HEAP *heap, const void *ptr )
+{
+    struct profile_block *block, **next;
+
+    if (heap == profile.heap || !profile.live) return;
+
+    RtlEnterCriticalSection( &profile_section );
+
+    for (next = &profile.blocks[profile_block_hash( ptr )]; (block = *next); next = &block->next)
+    {
+        if (block->ptr != ptr || block->stack->heap != heap) continue;
+        *next = block->next;
+        block->stack->live_count--;
+        block->stack->live_bytes -= block->size;
+        RtlFreeHeap( profile.heap, 0, block );
+        InterlockedDecrement( &profile.live );
+        break;
+    }
+
+    RtlLeaveCriticalSection( &profile_section );
+}
+
+/* forget the live blocks of a heap that is being destroyed */
+static void profile_destroy_heap( HEAP *heap )
+{
+    struct profile_block *block, **next;
+    unsigned int i;
+
+    RtlEnterCriticalSection( &profile_section );
+
+    for (i = 0; i < PROFILE_HASH_SIZE; i++)
+    {
+        next = &profile.blocks[i];
+        while ((block = *next))
+        {
+            if (block->stack->heap != heap)
+            {
+                next = &block->next;
+                continue;
+            }
+            *next = block->next;
+            block->stack->live_count--;
+            block->stack->live_bytes -= block->size;
+            RtlFreeHeap( profile.heap, 0, block );
+            InterlockedDecrement( &profile.live );
+        }
+    }
+
+    RtlLeaveCriticalSection( &profile_section );
+}
+
+
 /***********************************************************************
  *           allocate_large_block
  */
@@ -789,6 +955,7 @@ static void *realloc_large_block( HEAP *heap, DWORD flags, void *ptr, SIZE_T siz
         return NULL;
     }
     memcpy( new_ptr, ptr, arena->data_size );
+    if (profile.rate) profile_free( heap, ptr );
     free_large_block( heap, flags, ptr );
     notify_free( ptr );
     return new_ptr;
@@ -1515,6 +1682,153 @@ static void heap_set_debug_flags( HANDLE handle )
 }
 
 
+static void profile_write( HANDLE file, char *buffer, int *pos, BOOL flush )
+{
+    IO_STATUS_BLOCK io;
+
+    if (!flush && *pos < 0x800) return;
+    NtWriteFile( file, 0, NULL, NULL, &io, buffer, *pos, NULL, NULL );
+    *pos = 0;
+}
+
+/* write the samples of one heap in the legacy pprof heap profile format */
+static void profile_dump_heap( HEAP *heap )
+{
+    static const char maps_header[] = "\nMAPPED_LIBRARIES:\n";
+    SIZE_T live_count = 0, live_bytes = 0, alloc_count = 0, alloc_bytes = 0;
+    const LIST_ENTRY *mark, *entry;
+    struct profile_stack *stack;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING nt_name;
+    IO_STATUS_BLOCK io;
+    WCHAR *name;
+    HANDLE file;
+    char buffer[0x1000];
+    unsigned int i, j;
+    int pos = 0;
+
+    if (!(name = RtlAllocateHeap( profile.heap, 0, profile.file.Length + 32 * sizeof(WCHAR) ))) return;
+    memcpy( name, profile.file.Buffer, profile.file.Length );
+    swprintf( name + profile.file.Length / sizeof(WCHAR), 32, L".%u.%p",
+              HandleToULong( NtCurrentTeb()->ClientId.UniqueProcess ), heap );
+    if (!RtlDosPathNameToNtPathName_U( name, &nt_name, NULL, NULL ))
+    {
+        RtlFreeHeap( profile.heap, 0, name );
+        return;
+    }
+    InitializeObjectAttributes( &attr, &nt_name, OBJ_CASE_INSENSITIVE, 0, NULL );
+    if (NtCreateFile( &file, GENERIC_WRITE | SYNCHRONIZE, &attr, &io, NULL, FILE_ATTRIBUTE_NORMAL, 0,
+                      FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE, NULL, 0 ))
+    {
+        ERR( "failed to create heap profile %s\n", debugstr_w(name) );
+        goto done;
+    }
+
+    for (i = 0; i < PROFILE_HASH_SIZE; i++)
+    {
+        for (stack = profile.stacks[i]; stack; stack = stack->next)
+        {
+            if (stack->heap != heap) continue;
+            live_count += stack->live_count;
+            live_bytes += stack->live_bytes;
+            alloc_count += stack->alloc_count;
+            alloc_bytes += stack->alloc_bytes;
+        }
+    }
+    pos += sprintf( buffer + pos, "heap profile: %Iu: %Iu [%Iu: %Iu] @ heap_v2/%u\n",
+                    live_count, live_bytes, alloc_count, alloc_bytes, profile.rate );
+
+    for (i = 0; i < PROFILE_HASH_SIZE; i++)
+    {
+        for (stack = profile.stacks[i]; stack; stack = stack->next)
+        {
+            if (stack->heap != heap) continue;
+            pos += sprintf( buffer + pos, "%Iu: %Iu [%Iu: %Iu] @", stack->live_count, stack->live_bytes,
+                            stack->alloc_count, stack->alloc_bytes );
+            for (j = 0; j < stack->depth; j++)
+                pos += sprintf( buffer + pos, " 0x%Ix", (ULONG_PTR)stack->frames[j] );
+            buffer[pos++] = '\n';
+            profile_write( file, buffer, &pos, FALSE );
+        }
+    }
+
+    memcpy( buffer + pos, maps_header, sizeof(maps_header) - 1 );
+    pos += sizeof(maps_header) - 1;
+    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
+    {
+        const LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD( entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks );
+
+        pos += sprintf( buffer + pos, "%Ix-%Ix r-xp 00000000 00:00 0 %.*S\n", (ULONG_PTR)mod->DllBase,
+                        (ULONG_PTR)mod->DllBase + mod->SizeOfImage,
+                        (int)min( mod->FullDllName.Length / sizeof(WCHAR), MAX_PATH ), mod->FullDllName.Buffer );
+        profile_write( file, buffer, &pos, FALSE );
+    }
+    profile_write( file, buffer, &pos, TRUE );
+    NtClose( file );
+
+done:
+    RtlFreeUnicodeString( &nt_name );
+    RtlFreeHeap( profile.heap, 0, name );
+}
+
+/***********************************************************************
+ *           heap_profile_init
+ */
+void heap_profile_init(void)
+{
+    static const WCHAR nameW[] = L"WINEHEAPPROFILE";
+    UNICODE_STRING name, value;
+    ULONG rate = PROFILE_DEFAULT_RATE;
+    WCHAR *p;
+
+    RtlInitUnicodeString( &name, nameW );
+    value.Length = value.MaximumLength = 0;
+    value.Buffer = NULL;
+    if (RtlQueryEnvironmentVariable_U( NULL, &name, &value ) != STATUS_BUFFER_TOO_SMALL) return;
+    if (!(profile.heap = RtlCreateHeap( HEAP_GROWABLE, NULL, 0, 0, NULL, NULL ))) return;
+
+    value.MaximumLength = value.Length + sizeof(WCHAR);
+    value.Buffer = RtlAllocateHeap( profile.heap, 0, value.MaximumLength );
+    if (!value.Buffer || RtlQueryEnvironmentVariable_U( NULL, &name, &value )) return;
+
+    if ((p = wcsrchr( value.Buffer, ',' )))
+    {
+        rate = max( wcstoul( p + 1, NULL, 0 ), 1 );
+        value.Length = (p - value.Buffer) * sizeof(WCHAR);
+    }
+    profile.file = value;
+    profile.rate = rate;
+    TRACE( "sampling every %u bytes to %s\n", profile.rate, debugstr_us(&profile.file) );
+}
+
+/***********************************************************************
+ *           heap_profile_dump
+ *
+ * Write a profile file for each heap that has samples.
+ */
+void heap_profile_dump(void)
+{
+    HEAP *heaps[64];
+    struct profile_stack *stack;
+    unsigned int i, j, count = 0;
+
+    if (!profile.rate) return;
+
+    RtlEnterCriticalSection( &profile_section );
+    for (i = 0; i < PROFILE_HASH_SIZE; i++)
+    {
+        for (stack = profile.stacks[i]; stack; stack = stack->next)
+        {
+            for (j = 0; j < count; j++) if (heaps[j] == stack->heap) break;
+            if (j == count && count < ARRAY_SIZE(heaps)) heaps[count++] = stack->heap;
+        }
+    }
+    for (i = 0; i < count; i++) profile_dump_heap( heaps[i] );
+    RtlLeaveCriticalSection( &profile_section );
+}
+
+
 /***********************************************************************
  *           RtlCreateHeap   (NTDLL.@)
  *
@@ -1598,6 +1912,8 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
 
     if (heap == processHeap) return heap; /* cannot delete the main process heap */
 
+    if (profile.rate) profile_destroy_heap( heapPtr );
+
     /* remove it from the per-process list */
     RtlEnterCriticalSection( &processHeap->critSection );
     list_remove( &heapPtr->entry );
@@ -1676,6 +1992,7 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
         void *ret = allocate_large_block( heap, flags, size );
         if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
         if (!ret && (flags & HEAP_GENERATE_EXCEPTIONS)) RtlRaiseStatus( STATUS_NO_MEMORY );
+        if (ret && profile.rate) profile_alloc( heapPtr, ret, size );
         TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
         return ret;
     }
@@ -1714,6 +2031,8 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
 
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
 
+    if (profile.rate) profile_alloc( heapPtr, pInUse + 1, size );
+
     TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, pInUse + 1 );
     return pInUse + 1;
 }
@@ -1761,6 +2080,8 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE heap, ULONG flags, void *pt
     pInUse  = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pInUse )) goto error;
 
+    if (profile.rate) profile_free( heapPtr, ptr );
+
     if (!subheap)
         free_large_block( heapPtr, flags, ptr );
     else
@@ -1840,6 +2161,7 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
             if (flags & HEAP_REALLOC_IN_PLACE_ONLY) goto oom;
             if (!(ret = allocate_large_block( heapPtr, flags, size ))) goto oom;
             memcpy( ret, pArena + 1, oldActualSize );
+            if (profile.rate) profile_free( heapPtr, ptr );
             notify_free( pArena + 1 );
             HEAP_MakeInUseBlockFree( subheap, pArena );
             goto done;
@@ -1881,6 +2203,7 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
 
             /* Free the previous block */
 
+            if (profile.rate) profile_free( heapPtr, ptr );
             notify_free( pArena + 1 );
             HEAP_MakeInUseBlockFree( subheap, pArena );
             subheap = newsubheap;
@@ -1907,7 +2230,10 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
 
     ret = pArena + 1;
 done:
+    /* moved blocks are forgotten before the old block is released */
+    if (profile.rate && ret == ptr) profile_free( heapPtr, ptr );
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+    if (profile.rate) profile_alloc( heapPtr, ret, size );
     TRACE("(%p,%08x,%p,%08lx): returning %p\n", heap, flags, ptr, size, ret );
     return ret;
 
@@ -3542,6 +3542,7 @@ void WINAPI LdrShutdownProcess(void)
         RtlProcessFlsData( NtCurrentTeb()->FlsSlots, 1 );
 
     process_detach();
+    heap_profile_dump();
 }
 
 
@@ -3628,6 +3629,9 @@ static void free_modref( WINE_MODREF *wm )
     RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
     if (wm->ldr.InInitializationOrderLinks.Flink)
         RemoveEntryList(&wm->ldr.InInitializationOrderLinks);
+#if defined(__x86_64__) || defined(__arm__) || defined(__aarch64__)
+    flush_function_info_cache();
+#endif
 
     while ((entry = wm->ldr.DdagNode->Dependencies.Tail))
     {
@@ -4006,6 +4010,7 @@ void WINAPI LdrInitializeThunk( CONTEXT *context, ULONG_PTR unknown2, ULONG_PTR
 
         init_user_process_params();
         load_global_options();
+        heap_profile_init();
         version_init();
 
         get_env_var( L"WINESYSTEMDLLPATH", 0, &system_dll_path );
@@ -2587,6 +2587,14 @@ static void test_dynamic_unwind(void)
     ok( !pRtlDeleteFunctionTable( runtime_func ),
         "RtlDeleteFunctionTable returned success for nonexistent table runtime_func = %p\n", runtime_func );
 
+    /* Lookup again after the table is gone */
+    base = 0xdeadbeef;
+    func = pRtlLookupFunctionEntry( (ULONG_PTR)code_mem + code_offset + 8, &base, NULL );
+    ok( func == NULL,
+        "RtlLookupFunctionEntry returned unexpected function, expected: NULL, got: %p\n", func );
+    ok( !base || broken(base == 0xdeadbeef),
+        "RtlLookupFunctionEntry modified base address, expected: 0, got: %lx\n", base );
+
     /* Unaligned RUNTIME_FUNCTION pointer */
     runtime_func = (RUNTIME_FUNCTION *)((ULONG_PTR)buf | 0x3);
     runtime_func->BeginAddress = code_offset;
@@ -4253,6 +4253,106 @@ static void test_NtCreateFile(void)
     DeleteFileW( path );
 }
 
+/* move the directory times to the past, so that ntdll can cache its contents */
+static void age_directory( const char *dir )
+{
+    ULARGE_INTEGER time;
+    FILETIME ft;
+    HANDLE handle;
+    BOOL ret;
+
+    handle = CreateFileA( dir, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                          NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, 0 );
+    ok( handle != INVALID_HANDLE_VALUE, "CreateFile failed %u\n", GetLastError() );
+    GetSystemTimeAsFileTime( &ft );
+    time.u.LowPart = ft.dwLowDateTime;
+    time.u.HighPart = ft.dwHighDateTime;
+    time.QuadPart -= (ULONGLONG)3600 * 10000000;
+    ft.dwLowDateTime = time.u.LowPart;
+    ft.dwHighDateTime = time.u.HighPart;
+    ret = SetFileTime( handle, NULL, &ft, &ft );
+    ok( ret, "SetFileTime failed %u\n", GetLastError() );
+    CloseHandle( handle );
+}
+
+static void check_file_exists_( unsigned int line, const char *dir, const char *name, BOOL exists )
+{
+    char path[MAX_PATH];
+    HANDLE handle;
+
+    sprintf( path, "%s\\%s", dir, name );
+    handle = CreateFileA( path, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, 0 );
+    if (exists)
+    {
+        ok_(__FILE__, line)( handle != INVALID_HANDLE_VALUE, "CreateFile %s failed %u\n", name, GetLastError() );
+        CloseHandle( handle );
+    }
+    else
+    {
+        ok_(__FILE__, line)( handle == INVALID_HANDLE_VALUE, "CreateFile %s succeeded\n", name );
+        ok_(__FILE__, line)( GetLastError() == ERROR_FILE_NOT_FOUND, "got error %u\n", GetLastError() );
+        if (handle != INVALID_HANDLE_VALUE) CloseHandle( handle );
+    }
+}
+#define check_file_exists(a,b,c) check_file_exists_(__LINE__,a,b,c)
+
+static void test_case_insensitive_open(void)
+{
+    char temppath[MAX_PATH], dir[MAX_PATH], path[MAX_PATH], path2[MAX_PATH];
+    HANDLE handle;
+    BOOL ret;
+
+    GetTempPathA( MAX_PATH, temppath );
+    GetTempFileNameA( temppath, "foo", 0, dir );
+    DeleteFileA( dir );
+    ret = CreateDirectoryA( dir, NULL );
+    ok( ret, "CreateDirectory failed %u\n", GetLastError() );
+
+    sprintf( path, "%s\\MixedCase.txt", dir );
+    handle = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0 );
+    ok( handle != INVALID_HANDLE_VALUE, "CreateFile failed %u\n", GetLastError() );
+    CloseHandle( handle );
+
+    /* repeated lookups with a different case, recently modified directories aren't cached */
+    check_file_exists( dir, "MIXEDCASE.TXT", TRUE );
+    check_file_exists( dir, "mixedcase.txt", TRUE );
+    check_file_exists( dir, "MIXEDCASE2.TXT", FALSE );
+
+    age_directory( dir );
+    check_file_exists( dir, "MIXEDCASE.TXT", TRUE );
+    check_file_exists( dir, "mixedcase.txt", TRUE );
+    check_file_exists( dir, "MIXEDCASE2.TXT", FALSE );
+
+    /* lookups must reflect changes to the directory */
+    sprintf( path, "%s\\mixedCASE.txt", dir );
+    sprintf( path2, "%s\\Renamed.txt", dir );
+    ret = MoveFileA( path, path2 );
+    ok( ret, "MoveFile failed %u\n", GetLastError() );
+    check_file_exists( dir, "MIXEDCASE.TXT", FALSE );
+    check_file_exists( dir, "RENAMED.TXT", TRUE );
+
+    age_directory( dir );
+    check_file_exists( dir, "RENAMED.TXT", TRUE );
+    check_file_exists( dir, "ADDED.TXT", FALSE );
+    sprintf( path, "%s\\Added.txt", dir );
+    handle = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, 0 );
+    ok( handle != INVALID_HANDLE_VALUE, "CreateFile failed %u\n", GetLastError() );
+    CloseHandle( handle );
+    check_file_exists( dir, "ADDED.TXT", TRUE );
+
+    age_directory( dir );
+    check_file_exists( dir, "ADDED.TXT", TRUE );
+    ret = DeleteFileA( path2 );
+    ok( ret, "DeleteFile failed %u\n", GetLastError() );
+    check_file_exists( dir, "RENAMED.TXT", FALSE );
+    check_file_exists( dir, "ADDED.TXT", TRUE );
+
+    ret = DeleteFileA( path );
+    ok( ret, "DeleteFile failed %u\n", GetLastError() );
+    ret = RemoveDirectoryA( dir );
+    ok( ret, "RemoveDirectory failed %u\n", GetLastError() );
+}
+
 static void test_read_write(void)
 {
     static const char contents[14] = "1234567890abcd";
@@ -5284,6 +5384,7 @@ START_TEST(file)
 
     test_read_write();
     test_NtCreateFile();
+    test_case_insensitive_open();
     create_file_test();
     open_file_test();
     delete_file_test();
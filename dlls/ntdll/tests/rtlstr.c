@@ -2611,6 +2611,72 @@ static void test_RtlUTF8ToUnicodeN(void)
     }
 }
 
+static void test_utf8_ascii_runs(void)
+{
+    char utf8[80], bufA[80];
+    WCHAR unicode[80], bufW[80];
+    unsigned int pos, offset, len, i;
+    ULONG bytes_out;
+    NTSTATUS status;
+
+    if (!pRtlUTF8ToUnicodeN || !pRtlUnicodeToUTF8N)
+    {
+        skip("RtlUTF8ToUnicodeN or RtlUnicodeToUTF8N unavailable\n");
+        return;
+    }
+
+    /* a non-ASCII character at every position and alignment of an ASCII run */
+    for (pos = 0; pos < 48; pos++)
+    {
+        for (offset = 0; offset < 8; offset++)
+        {
+            for (i = 0; i < 48; i++)
+            {
+                utf8[offset + i + (i > pos)] = 'a' + i % 26;
+                unicode[offset + i] = 'a' + i % 26;
+            }
+            utf8[offset + pos] = 0xc3;
+            utf8[offset + pos + 1] = 0xa9;
+            unicode[offset + pos] = 0xe9;
+            len = 48;
+
+            status = pRtlUTF8ToUnicodeN(NULL, 0, &bytes_out, utf8 + offset, len + 1);
+            ok(status == STATUS_SUCCESS, "%u/%u: status = 0x%x\n", pos, offset, status);
+            ok(bytes_out == len * sizeof(WCHAR), "%u/%u: bytes_out = %u\n", pos, offset, bytes_out);
+
+            memset(bufW, 0x55, sizeof(bufW));
+            status = pRtlUTF8ToUnicodeN(bufW, sizeof(bufW), &bytes_out, utf8 + offset, len + 1);
+            ok(status == STATUS_SUCCESS, "%u/%u: status = 0x%x\n", pos, offset, status);
+            ok(bytes_out == len * sizeof(WCHAR), "%u/%u: bytes_out = %u\n", pos, offset, bytes_out);
+            ok(!memcmp(bufW, unicode + offset, len * sizeof(WCHAR)), "%u/%u: got %s\n",
+               pos, offset, wine_dbgstr_wn(bufW, len));
+
+            memset(bufW, 0x55, sizeof(bufW));
+            status = pRtlUTF8ToUnicodeN(bufW, pos * sizeof(WCHAR), &bytes_out, utf8 + offset, len + 1);
+            ok(status == STATUS_BUFFER_TOO_SMALL, "%u/%u: status = 0x%x\n", pos, offset, status);
+            ok(bytes_out == pos * sizeof(WCHAR), "%u/%u: bytes_out = %u\n", pos, offset, bytes_out);
+            ok(bufW[pos] == 0x5555, "%u/%u: behind string: 0x%x\n", pos, offset, bufW[pos]);
+
+            status = pRtlUnicodeToUTF8N(NULL, 0, &bytes_out, unicode + offset, len * sizeof(WCHAR));
+            ok(status == STATUS_SUCCESS, "%u/%u: status = 0x%x\n", pos, offset, status);
+            ok(bytes_out == len + 1, "%u/%u: bytes_out = %u\n", pos, offset, bytes_out);
+
+            memset(bufA, 0x55, sizeof(bufA));
+            status = pRtlUnicodeToUTF8N(bufA, sizeof(bufA), &bytes_out, unicode + offset, len * sizeof(WCHAR));
+            ok(status == STATUS_SUCCESS, "%u/%u: status = 0x%x\n", pos, offset, status);
+            ok(bytes_out == len + 1, "%u/%u: bytes_out = %u\n", pos, offset, bytes_out);
+            ok(!memcmp(bufA, utf8 + offset, len + 1), "%u/%u: got %s\n",
+               pos, offset, wine_dbgstr_an(bufA, len + 1));
+
+            memset(bufA, 0x55, sizeof(bufA));
+            status = pRtlUnicodeToUTF8N(bufA, pos, &bytes_out, unicode + offset, len * sizeof(WCHAR));
+            ok(status == STATUS_BUFFER_TOO_SMALL, "%u/%u: status = 0x%x\n", pos, offset, status);
+            ok(bytes_out == pos, "%u/%u: bytes_out = %u\n", pos, offset, bytes_out);
+            ok(bufA[pos] == 0x55, "%u/%u: behind string: 0x%x\n", pos, offset, bufA[pos]);
+        }
+    }
+}
+
 static NTSTATUS WINAPIV fmt( const WCHAR *src, ULONG width, BOOLEAN ignore_inserts, BOOLEAN ansi,
                              WCHAR *buffer, ULONG size, ULONG *retsize, ... )
 {
@@ -2923,5 +2989,6 @@ START_TEST(rtlstr)
     test_RtlHashUnicodeString();
     test_RtlUnicodeToUTF8N();
     test_RtlUTF8ToUnicodeN();
+    test_utf8_ascii_runs();
     test_RtlFormatMessage();
 }
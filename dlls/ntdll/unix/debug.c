@@ -26,11 +26,14 @@
 
 #include <assert.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -65,6 +68,46 @@ static struct __wine_debug_channel *debug_options;
 
 static const char * const debug_classes[] = { "fixme", "err", "warn", "trace" };
 
+/* binary trace log, enabled with WINEDEBUGLOG */
+
+#define TRACE_RING_SIZE  0x20000  /* per thread, must be a power of 2 */
+#define TRACE_MAX_TEXT   0x1000
+
+struct trace_log_header
+{
+    char      magic[8];      /* "WINETRC" */
+    UINT      version;
+    UINT      pid;
+    ULONGLONG ticks_per_sec; /* units of the record timestamps */
+};
+
+struct trace_record
+{
+    UINT      size;          /* size of the record including padding */
+    UINT      len;           /* length of the text following the record */
+    UINT      tid;
+    UINT      reserved;
+    ULONGLONG time;          /* monotonic time in ticks_per_sec units */
+};
+
+/* Each thread queues its records in its own ring, so a thread that dies while
+ * writing a record only loses that record. Rings of exited threads are reused. */
+struct trace_ring
+{
+    struct trace_ring *next;       /* next ring in trace_rings */
+    LONG               in_use;     /* owned by a thread */
+    volatile LONG      busy;       /* a record is being written, to catch nested calls from signal handlers */
+    volatile UINT      head;       /* end of the committed records */
+    volatile UINT      tail;       /* start of the unflushed records */
+    char               data[TRACE_RING_SIZE];
+};
+
+static int trace_fd = -1;
+static struct trace_ring *trace_rings;     /* all rings, never freed */
+static pthread_key_t trace_ring_key;
+static LONG trace_dropped;                 /* records lost because a ring was full */
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;  /* serializes flushing */
+
 /* get the debug info pointer for the current thread */
 static inline struct debug_info *get_info(void)
 {
@@ -90,6 +133,191 @@ static int append_output( struct debug_info *info, const char *str, size_t len )
     return len;
 }
 
+static ULONGLONG trace_time(void)
+{
+    LARGE_INTEGER counter;
+
+    NtQueryPerformanceCounter( &counter, NULL );
+    return counter.QuadPart;
+}
+
+/* copy data into a trace ring, wrapping around the end */
+static void trace_ring_put( struct trace_ring *ring, UINT pos, const void *data, UINT len )
+{
+    UINT offset = pos & (TRACE_RING_SIZE - 1), count = min( len, TRACE_RING_SIZE - offset );
+
+    memcpy( ring->data + offset, data, count );
+    memcpy( ring->data, (const char *)data + count, len - count );
+}
+
+/* copy data out of a trace ring, wrapping around the end */
+static void trace_ring_get( struct trace_ring *ring, UINT pos, void *data, UINT len )
+{
+    UINT offset = pos & (TRACE_RING_SIZE - 1), count = min( len, TRACE_RING_SIZE - offset );
+
+    memcpy( data, ring->data + offset, count );
+    memcpy( (char *)data + count, ring->data, len - count );
+}
+
+/* thread exit callback */
+static void trace_ring_release( void *arg )
+{
+    struct trace_ring *ring = arg;
+
+    ring->busy = 0;  /* the thread may have been killed while writing */
+    InterlockedExchange( &ring->in_use, 0 );
+}
+
+/* get the ring of the current thread, claiming or creating one if needed */
+static struct trace_ring *get_trace_ring(void)
+{
+    struct trace_ring *ring = pthread_getspecific( trace_ring_key );
+
+    if (ring) return ring;
+
+    for (ring = trace_rings; ring; ring = ring->next)
+        if (!InterlockedCompareExchange( &ring->in_use, 1, 0 )) break;
+
+    if (!ring)
+    {
+        /* not malloc, this may be called from a signal handler */
+        if ((ring = anon_mmap_alloc( sizeof(*ring), PROT_READ | PROT_WRITE )) == MAP_FAILED) return NULL;
+        ring->in_use = 1;
+        do ring->next = trace_rings;
+        while (InterlockedCompareExchangePointer( (void **)&trace_rings, ring, ring->next ) != ring->next);
+    }
+    pthread_setspecific( trace_ring_key, ring );
+    return ring;
+}
+
+/* queue a trace record; this never blocks, records are dropped when the ring is full */
+static void trace_log_write( const char *str, unsigned int len )
+{
+    struct trace_ring *ring = get_trace_ring();
+    struct trace_record rec;
+    UINT head, size = (sizeof(rec) + len + 7) & ~7;
+
+    if (!ring || ring->busy)
+    {
+        InterlockedIncrement( &trace_dropped );
+        return;
+    }
+    ring->busy = 1;
+
+    head = ring->head;
+    if (head + size - ring->tail > TRACE_RING_SIZE)
+    {
+        InterlockedIncrement( &trace_dropped );
+    }
+    else
+    {
+        rec.size = size;
+        rec.len = len;
+        rec.tid = init_done ? GetCurrentThreadId() : 0;
+        rec.reserved = 0;
+        rec.time = trace_time();
+        trace_ring_put( ring, head, &rec, sizeof(rec) );
+        trace_ring_put( ring, head + sizeof(rec), str, len );
+        InterlockedExchange( (LONG *)&ring->head, head + size );  /* commit */
+    }
+    ring->busy = 0;
+}
+
+/* write the committed records of all threads to the log file */
+static void trace_log_flush(void)
+{
+    static char buffer[0x10000];
+    struct trace_ring *ring;
+    unsigned int pos = 0;
+    UINT head, tail, size;
+    LONG dropped;
+
+    pthread_mutex_lock( &trace_mutex );
+    for (ring = trace_rings; ring; ring = ring->next)
+    {
+        head = InterlockedCompareExchange( (LONG *)&ring->head, 0, 0 );
+        for (tail = ring->tail; tail != head; tail += size)
+        {
+            trace_ring_get( ring, tail, &size, sizeof(size) );
+            if (pos + size > sizeof(buffer))
+            {
+                write( trace_fd, buffer, pos );
+                pos = 0;
+            }
+            trace_ring_get( ring, tail, buffer + pos, size );
+            pos += size;
+        }
+        InterlockedExchange( (LONG *)&ring->tail, tail );
+    }
+    if ((dropped = InterlockedExchange( &trace_dropped, 0 )))
+    {
+        struct trace_record *rec = (struct trace_record *)(buffer + pos);
+        char *text = (char *)(rec + 1);
+
+        if (pos + sizeof(*rec) + 64 > sizeof(buffer))
+        {
+            write( trace_fd, buffer, pos );
+            pos = 0;
+            rec = (struct trace_record *)buffer;
+            text = (char *)(rec + 1);
+        }
+        rec->len = sprintf( text, "trace log: %d records dropped\n", dropped );
+        rec->size = (sizeof(*rec) + rec->len + 7) & ~7;
+        rec->tid = rec->reserved = 0;
+        rec->time = trace_time();
+        pos += rec->size;
+    }
+    if (pos) write( trace_fd, buffer, pos );
+    pthread_mutex_unlock( &trace_mutex );
+}
+
+static void *trace_flush_thread( void *arg )
+{
+    for (;;)
+    {
+        usleep( 10000 );
+        trace_log_flush();
+    }
+    return NULL;
+}
+
+/* open the binary trace log, one file per process */
+static void init_trace_log( const char *name )
+{
+    struct trace_log_header header = { "WINETRC", 1, getpid(), TICKSPERSEC };
+    char *filename;
+
+    if (pthread_key_create( &trace_ring_key, trace_ring_release )) return;
+    if (!(filename = malloc( strlen(name) + 16 ))) return;
+    sprintf( filename, "%s.%u", name, header.pid );
+    if ((trace_fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0666 )) != -1)
+    {
+        fcntl( trace_fd, F_SETFD, FD_CLOEXEC );
+        write( trace_fd, &header, sizeof(header) );
+        atexit( trace_log_flush );
+    }
+    else fprintf( stderr, "wine: failed to create debug log %s\n", filename );
+    free( filename );
+}
+
+/* start the thread that flushes the binary trace log to disk */
+static void start_trace_flush_thread(void)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+    sigset_t sigset, old_set;
+
+    /* keep all signals away from it, it has no TEB */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_SETMASK, &sigset, &old_set );
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    if (pthread_create( &thread, &attr, trace_flush_thread, NULL ))
+        fprintf( stderr, "wine: failed to start debug log thread, flushing only at exit\n" );
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_set, NULL );
+}
+
 /* add a new debug option at the end of the option list */
 static void add_option( const char *name, unsigned char set, unsigned char clear )
 {
@@ -194,12 +422,15 @@ static void debug_usage(void)
 static void init_options(void)
 {
     char *wine_debug = getenv("WINEDEBUG");
+    char *debug_log = getenv("WINEDEBUGLOG");
     struct stat st1, st2;
 
     nb_debug_options = 0;
 
+    if (debug_log && *debug_log) init_trace_log( debug_log );
+
     /* check for stderr pointing to /dev/null */
-    if (!fstat( 2, &st1 ) && S_ISCHR(st1.st_mode) &&
+    if (trace_fd == -1 && !fstat( 2, &st1 ) && S_ISCHR(st1.st_mode) &&
         !stat( "/dev/null", &st2 ) && S_ISCHR(st2.st_mode) &&
         st1.st_rdev == st2.st_rdev)
     {
@@ -257,7 +488,16 @@ const char * __cdecl __wine_dbg_strdup( const char *str )
  */
 int WINAPI __wine_dbg_write( const char *str, unsigned int len )
 {
-    return write( 2, str, len );
+    unsigned int pos, count;
+
+    if (trace_fd == -1) return write( 2, str, len );
+
+    for (pos = 0; pos < len; pos += count)
+    {
+        count = min( len - pos, TRACE_MAX_TEXT );
+        trace_log_write( str + pos, count );
+    }
+    return len;
 }
 
 /***********************************************************************
@@ -330,6 +570,8 @@ void dbg_init(void)
     debug_options = options;
     options[nb_debug_options] = default_option;
     init_done = TRUE;
+
+    if (trace_fd != -1) start_trace_flush_thread();
 }
 
 
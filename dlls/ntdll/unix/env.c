@@ -610,6 +610,40 @@ static unsigned int decode_utf8_char( unsigned char ch, const char **str, const
     return ~0;
 }
 
+/* length of the initial 7-bit ASCII run of a UTF-8 string, checked a word at a time */
+static inline unsigned int utf8_ascii_len( const char *src, unsigned int srclen )
+{
+    static const ULONG_PTR high_bits = ~(ULONG_PTR)0 / 0xff * 0x80;
+    const char *start = src, *end = src + srclen;
+
+    while (src < end && ((ULONG_PTR)src & (sizeof(ULONG_PTR) - 1)))
+    {
+        if ((unsigned char)*src >= 0x80) return src - start;
+        src++;
+    }
+    while (end - src >= sizeof(ULONG_PTR) && !(*(const ULONG_PTR *)src & high_bits))
+        src += sizeof(ULONG_PTR);
+    while (src < end && (unsigned char)*src < 0x80) src++;
+    return src - start;
+}
+
+/* length of the initial 7-bit ASCII run of a UTF-16 string, checked a word at a time */
+static inline unsigned int utf16_ascii_len( const WCHAR *src, unsigned int srclen )
+{
+    static const ULONG_PTR high_bits = ~(ULONG_PTR)0 / 0xffff * 0xff80;
+    const WCHAR *start = src, *end = src + srclen;
+
+    while (src < end && ((ULONG_PTR)src & (sizeof(ULONG_PTR) - 1)))
+    {
+        if (*src >= 0x80) return src - start;
+        src++;
+    }
+    while (end - src >= sizeof(ULONG_PTR) / sizeof(WCHAR) && !(*(const ULONG_PTR *)src & high_bits))
+        src += sizeof(ULONG_PTR) / sizeof(WCHAR);
+    while (src < end && *src < 0x80) src++;
+    return src - start;
+}
+
 
 /******************************************************************
  *      ntdll_umbstowcs  (ntdll.so)
@@ -711,6 +745,11 @@ int ntdll_wcstoumbs( const WCHAR *src, DWORD srclen, char *dst, DWORD dstlen, BO
             {
                 if (dst > end - 1) break;
                 *dst++ = ch;
+                val = utf16_ascii_len( src + 1, min( srclen - 1, end - dst ));
+                for (i = 0; i < val; i++) dst[i] = src[i + 1];
+                dst += val;
+                src += val;
+                srclen -= val;
                 continue;
             }
             if (ch < 0x800)  /* 0x80-0x7ff: 2 bytes */
@@ -803,6 +842,15 @@ const char *ntdll_get_data_dir(void)
 }
 
 
+/***********************************************************************
+ *           ntdll_get_config_dir  (ntdll.so)
+ */
+const char *ntdll_get_config_dir(void)
+{
+    return config_dir;
+}
+
+
 /***********************************************************************
  *           build_envp
  *
@@ -2564,7 +2612,13 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
         for (len = 0; src < srcend; len++)
         {
             unsigned char ch = *src++;
-            if (ch < 0x80) continue;
+            if (ch < 0x80)
+            {
+                res = utf8_ascii_len( src, srcend - src );
+                src += res;
+                len += res;
+                continue;
+            }
             if ((res = decode_utf8_char( ch, &src, srcend )) > 0x10ffff)
                 status = STATUS_SOME_NOT_MAPPED;
             else
@@ -2580,6 +2634,10 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
         if (ch < 0x80)  /* special fast case for 7-bit ASCII */
         {
             *dst++ = ch;
+            len = utf8_ascii_len( src, min( srcend - src, dstend - dst ));
+            for (res = 0; res < len; res++) dst[res] = (unsigned char)src[res];
+            src += len;
+            dst += len;
             continue;
         }
         if ((res = decode_utf8_char( ch, &src, srcend )) <= 0xffff)
@@ -231,6 +231,10 @@ static unsigned int dir_data_cache_size;
 static BOOL show_dot_files;
 static mode_t start_umask;
 
+/* overlapped reads of regular files up to this size are queued in the server (WINEASYNCREADS) */
+#define MAX_SERVER_FILE_READ 0x100000
+static BOOL server_file_reads;
+
 /* at some point we may want to allow Winelib apps to set this */
 static const BOOL is_case_sensitive = FALSE;
 
@@ -1517,6 +1521,36 @@ static int get_file_info( const char *path, struct stat *st, ULONG *attr )
 }
 
 
+/* get the stat info and file attributes for an entry of a directory being read (by name
+ * relative to the directory); same as get_file_info, but since the parent of a subdirectory
+ * is the directory itself, mount points are detected without stat()ing the parent again */
+static int get_dir_entry_info( const char *name, const struct file_identity *dir_id,
+                               struct stat *st, ULONG *attr )
+{
+    int ret;
+
+    if (!strcmp( name, "." ) || !strcmp( name, ".." )) return get_file_info( name, st, attr );
+
+    *attr = 0;
+    ret = lstat( name, st );
+    if (ret == -1) return ret;
+    if (S_ISLNK( st->st_mode ))
+    {
+        ret = stat( name, st );
+        if (ret == -1) return ret;
+        /* is a symbolic link and a directory, consider these "reparse points" */
+        if (S_ISDIR( st->st_mode )) *attr |= FILE_ATTRIBUTE_REPARSE_POINT;
+    }
+    else if (S_ISDIR( st->st_mode ) && (st->st_dev != dir_id->dev || st->st_ino == dir_id->ino))
+    {
+        /* consider mount points to be reparse points (IO_REPARSE_TAG_MOUNT_POINT) */
+        *attr |= FILE_ATTRIBUTE_REPARSE_POINT;
+    }
+    *attr |= get_file_attributes( st );
+    return ret;
+}
+
+
 #if defined(__ANDROID__) && !defined(HAVE_FUTIMENS)
 static int futimens( int fd, const struct timespec spec[2] )
 {
@@ -2011,7 +2045,7 @@ static NTSTATUS get_dir_data_entry( struct dir_data *dir_data, void *info_ptr, I
     struct stat st;
     ULONG name_len, start, dir_size, attributes;
 
-    if (get_file_info( names->unix_name, &st, &attributes ) == -1)
+    if (get_dir_entry_info( names->unix_name, &dir_data->id, &st, &attributes ) == -1)
     {
         TRACE( "file no longer exists %s\n", names->unix_name );
         return STATUS_SUCCESS;
@@ -2481,6 +2515,175 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/* cache of directory contents for case-insensitive lookups in find_file_in_dir */
+
+#define DIR_LOOKUP_CACHE_SIZE 8
+
+struct dir_lookup_cache
+{
+    struct dir_data *data;       /* directory file names */
+    unsigned int    *hash;       /* hash table of indices in data->names, ~0u for free slots */
+    unsigned int     hash_size;  /* size of the hash table (power of 2) */
+    dev_t            dev;        /* directory device */
+    ino_t            ino;        /* directory inode */
+    LARGE_INTEGER    mtime;      /* directory modification time when it was read */
+    LARGE_INTEGER    ctime;      /* directory change time when it was read */
+    unsigned int     last_use;   /* generation of last use, for LRU replacement */
+};
+
+static struct dir_lookup_cache dir_lookup_cache[DIR_LOOKUP_CACHE_SIZE];
+static unsigned int dir_lookup_generation;
+static pthread_mutex_t dir_lookup_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* case-insensitive hash of a file name */
+static unsigned int hash_name_nocase( const WCHAR *name, unsigned int len )
+{
+    unsigned int i, hash = 0;
+
+    for (i = 0; i < len; i++) hash = hash * 31 + towupper( name[i] );
+    return hash;
+}
+
+static void free_dir_lookup_cache( struct dir_lookup_cache *cache )
+{
+    free_dir_data( cache->data );
+    free( cache->hash );
+    cache->data = NULL;
+    cache->hash = NULL;
+}
+
+/* read the contents of a directory into a lookup cache entry; helper for lookup_dir_cache */
+static BOOL fill_dir_lookup_cache( struct dir_lookup_cache *cache, const char *unix_name )
+{
+    static const WCHAR empty[1];
+    WCHAR buffer[MAX_DIR_ENTRY_LEN + 1];
+    struct dirent *de;
+    unsigned int i, pos, mask;
+    DIR *dir;
+    int ret;
+
+    if (!(cache->data = calloc( 1, sizeof(*cache->data) ))) return FALSE;
+    if (!(dir = opendir( unix_name ))) goto failed;
+
+    while ((de = readdir( dir )))
+    {
+        ret = ntdll_umbstowcs( de->d_name, strlen(de->d_name), buffer, MAX_DIR_ENTRY_LEN );
+        buffer[ret] = 0;
+        if (!add_dir_data_names( cache->data, buffer, empty, de->d_name ))
+        {
+            closedir( dir );
+            goto failed;
+        }
+    }
+    closedir( dir );
+
+    cache->hash_size = 16;
+    while (cache->hash_size < 2 * cache->data->count) cache->hash_size *= 2;
+    if (!(cache->hash = malloc( cache->hash_size * sizeof(*cache->hash) ))) goto failed;
+    memset( cache->hash, 0xff, cache->hash_size * sizeof(*cache->hash) );
+
+    /* entries are inserted in readdir order, so that the first match wins like in a linear scan */
+    mask = cache->hash_size - 1;
+    for (i = 0; i < cache->data->count; i++)
+    {
+        const WCHAR *long_name = cache->data->names[i].long_name;
+
+        pos = hash_name_nocase( long_name, wcslen( long_name )) & mask;
+        while (cache->hash[pos] != ~0u) pos = (pos + 1) & mask;
+        cache->hash[pos] = i;
+    }
+    return TRUE;
+
+failed:
+    free_dir_lookup_cache( cache );
+    return FALSE;
+}
+
+/***********************************************************************
+ *           lookup_dir_cache
+ *
+ * Look for a file name in the cached contents of the unix_name directory, reading
+ * the directory into the cache if needed. The cache is validated against the
+ * directory modification and change times, which are updated by any entry creation,
+ * deletion or rename. The file found is appended to unix_name at pos.
+ * Returns STATUS_NOT_SUPPORTED if the cache cannot be used for this directory.
+ */
+static NTSTATUS lookup_dir_cache( char *unix_name, int pos, const WCHAR *name, int length )
+{
+    struct dir_lookup_cache *cache = NULL;
+    LARGE_INTEGER mtime, ctime, atime, creation;
+    NTSTATUS status = STATUS_NOT_SUPPORTED;
+    unsigned int i, idx, mask;
+    struct stat st;
+    time_t now;
+
+    if (stat( unix_name, &st ) == -1) return STATUS_NOT_SUPPORTED;
+    get_file_times( &st, &mtime, &ctime, &atime, &creation );
+
+    mutex_lock( &dir_lookup_mutex );
+
+    for (i = 0; i < DIR_LOOKUP_CACHE_SIZE; i++)
+    {
+        if (!dir_lookup_cache[i].data) continue;
+        if (dir_lookup_cache[i].dev != st.st_dev || dir_lookup_cache[i].ino != st.st_ino) continue;
+        if (dir_lookup_cache[i].mtime.QuadPart == mtime.QuadPart &&
+            dir_lookup_cache[i].ctime.QuadPart == ctime.QuadPart)
+            cache = &dir_lookup_cache[i];
+        else
+            free_dir_lookup_cache( &dir_lookup_cache[i] );
+        break;
+    }
+
+    /* don't cache directories modified in the last second, since a further change
+     * may not be reflected in the modification time on file systems with a coarse
+     * granularity; later changes always move it to the current time */
+    now = time( NULL );
+    if (!cache && st.st_mtime < now - 1)
+    {
+        struct dir_lookup_cache *victim = &dir_lookup_cache[0];
+
+        for (i = 0; i < DIR_LOOKUP_CACHE_SIZE; i++)
+        {
+            if (!dir_lookup_cache[i].data)
+            {
+                victim = &dir_lookup_cache[i];
+                break;
+            }
+            if (dir_lookup_cache[i].last_use < victim->last_use) victim = &dir_lookup_cache[i];
+        }
+        free_dir_lookup_cache( victim );
+        if (fill_dir_lookup_cache( victim, unix_name ))
+        {
+            victim->dev   = st.st_dev;
+            victim->ino   = st.st_ino;
+            victim->mtime = mtime;
+            victim->ctime = ctime;
+            cache = victim;
+        }
+    }
+
+    if (cache)
+    {
+        cache->last_use = ++dir_lookup_generation;
+        status = STATUS_OBJECT_PATH_NOT_FOUND;
+        mask = cache->hash_size - 1;
+        for (i = hash_name_nocase( name, length ) & mask; (idx = cache->hash[i]) != ~0u; i = (i + 1) & mask)
+        {
+            const struct dir_data_names *names = &cache->data->names[idx];
+
+            if (wcslen( names->long_name ) != length || wcsnicmp( names->long_name, name, length )) continue;
+            unix_name[pos - 1] = '/';
+            strcpy( unix_name + pos, names->unix_name );
+            status = STATUS_SUCCESS;
+            break;
+        }
+    }
+
+    mutex_unlock( &dir_lookup_mutex );
+    return status;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2493,6 +2696,7 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
 {
     WCHAR buffer[MAX_DIR_ENTRY_LEN];
     BOOLEAN is_name_8_dot_3;
+    NTSTATUS status;
     DIR *dir;
     struct dirent *de;
     struct stat st;
@@ -2571,6 +2775,12 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    /* short names are not cached, so the cache is only authoritative for long names */
+
+    status = lookup_dir_cache( unix_name, pos, name, length );
+    if (status == STATUS_SUCCESS) return status;
+    if (status == STATUS_OBJECT_PATH_NOT_FOUND && !is_name_8_dot_3) goto not_found;
+
     if (!(dir = opendir( unix_name ))) return errno_to_status( errno );
 
     unix_name[pos - 1] = '/';
@@ -2796,6 +3006,8 @@ void init_files(void)
     start_umask = umask( 0777 );
     umask( start_umask );
 
+    server_file_reads = getenv( "WINEASYNCREADS" ) != NULL;
+
     if (!open_hkcu_key( "Software\\Wine", &key ))
     {
         static WCHAR showdotfilesW[] = {'S','h','o','w','D','o','t','F','i','l','e','s',0};
@@ -5155,6 +5367,13 @@ NTSTATUS WINAPI NtReadFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, vo
             goto done;
         }
 
+        if (async_read && server_file_reads && length <= MAX_SERVER_FILE_READ)
+        {
+            /* let the server queue the read, so that many reads can be in flight at once */
+            if (needs_close) close( unix_handle );
+            return server_read_file( handle, event, apc, apc_user, io, buffer, length, offset, key );
+        }
+
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
         {
             /* async I/O doesn't make sense on regular files */
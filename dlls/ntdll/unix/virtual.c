@@ -209,6 +209,7 @@ static struct file_view *view_block_start, *view_block_end, *next_free_view;
 static const size_t view_block_size = 0x100000;
 static void *preload_reserve_start;
 static void *preload_reserve_end;
+static int perf_map_fd = -1;  /* perf map file for mapped images, see WINEPERFMAP */
 static BOOL force_exec_prot;  /* whether to force PROT_EXEC on all PROT_READ mmaps */
 
 struct range_entry
@@ -2226,6 +2227,163 @@ static NTSTATUS map_pe_header( void *ptr, size_t size, int fd, BOOL *removable )
 }
 
 
+struct perf_symbol
+{
+    DWORD       rva;
+    const char *name;
+};
+
+static int compare_perf_symbols( const void *a, const void *b )
+{
+    const struct perf_symbol *sym1 = a, *sym2 = b;
+
+    if (sym1->rva != sym2->rva) return sym1->rva < sym2->rva ? -1 : 1;
+    if (!sym1->name != !sym2->name) return sym1->name ? -1 : 1;  /* named entries first */
+    return 0;
+}
+
+/***********************************************************************
+ *           get_perf_symbols
+ *
+ * Return the exported functions of an image, with their names when available.
+ */
+static struct perf_symbol *get_perf_symbols( char *ptr, SIZE_T total_size, const IMAGE_NT_HEADERS *nt,
+                                             const IMAGE_SECTION_HEADER *sections, DWORD *count )
+{
+    const IMAGE_DATA_DIRECTORY *dir = NULL;
+    const IMAGE_EXPORT_DIRECTORY *exports = NULL;
+    const IMAGE_SECTION_HEADER *sec;
+    const DWORD *functions, *names;
+    const WORD *ordinals;
+    struct perf_symbol *symbols;
+    DWORD i;
+
+    if (nt->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+    {
+        const IMAGE_OPTIONAL_HEADER64 *opt = (const IMAGE_OPTIONAL_HEADER64 *)&nt->OptionalHeader;
+        if (opt->NumberOfRvaAndSizes > IMAGE_DIRECTORY_ENTRY_EXPORT)
+            dir = &opt->DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+    }
+    else
+    {
+        const IMAGE_OPTIONAL_HEADER32 *opt = (const IMAGE_OPTIONAL_HEADER32 *)&nt->OptionalHeader;
+        if (opt->NumberOfRvaAndSizes > IMAGE_DIRECTORY_ENTRY_EXPORT)
+            dir = &opt->DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+    }
+    if (!dir || !dir->VirtualAddress || dir->Size < sizeof(*exports)) return NULL;
+
+    /* only trust the export directory if it lies in a readable section */
+    for (i = 0, sec = sections; i < nt->FileHeader.NumberOfSections; i++, sec++)
+    {
+        if (!(sec->Characteristics & IMAGE_SCN_MEM_READ)) continue;
+        if (dir->VirtualAddress < sec->VirtualAddress) continue;
+        if (dir->VirtualAddress - sec->VirtualAddress + sizeof(*exports) > sec->Misc.VirtualSize) continue;
+        exports = (const IMAGE_EXPORT_DIRECTORY *)(ptr + dir->VirtualAddress);
+        break;
+    }
+    if (!exports || !exports->NumberOfFunctions || exports->NumberOfFunctions > 0x10000) return NULL;
+    if (exports->AddressOfFunctions >= total_size ||
+        exports->NumberOfFunctions * sizeof(DWORD) > total_size - exports->AddressOfFunctions)
+        return NULL;
+    if (!(symbols = malloc( exports->NumberOfFunctions * sizeof(*symbols) ))) return NULL;
+
+    functions = (const DWORD *)(ptr + exports->AddressOfFunctions);
+    for (i = 0; i < exports->NumberOfFunctions; i++)
+    {
+        symbols[i].rva = functions[i];
+        symbols[i].name = NULL;
+    }
+
+    if (exports->NumberOfNames <= exports->NumberOfFunctions &&
+        exports->AddressOfNames < total_size && exports->AddressOfNameOrdinals < total_size &&
+        exports->NumberOfNames * sizeof(DWORD) <= total_size - exports->AddressOfNames &&
+        exports->NumberOfNames * sizeof(WORD) <= total_size - exports->AddressOfNameOrdinals)
+    {
+        names = (const DWORD *)(ptr + exports->AddressOfNames);
+        ordinals = (const WORD *)(ptr + exports->AddressOfNameOrdinals);
+        for (i = 0; i < exports->NumberOfNames; i++)
+        {
+            if (ordinals[i] >= exports->NumberOfFunctions || symbols[ordinals[i]].name) continue;
+            if (names[i] >= total_size || !memchr( ptr + names[i], 0, min( 256, total_size - names[i] ))) continue;
+            symbols[ordinals[i]].name = ptr + names[i];
+        }
+    }
+
+    qsort( symbols, exports->NumberOfFunctions, sizeof(*symbols), compare_perf_symbols );
+    *count = exports->NumberOfFunctions;
+    return symbols;
+}
+
+/***********************************************************************
+ *           perf_map_image
+ *
+ * Describe the code sections of a newly mapped image in the perf map file,
+ * one entry per exported function, so that perf can symbolize samples in PE code.
+ * virtual_mutex must be held by caller.
+ */
+static void perf_map_image( char *ptr, SIZE_T total_size, const WCHAR *filename, const IMAGE_NT_HEADERS *nt,
+                            const IMAGE_SECTION_HEADER *sections )
+{
+    const IMAGE_SECTION_HEADER *sec;
+    const WCHAR *p, *name = filename;
+    struct perf_symbol *symbols;
+    char module[MAX_PATH], buffer[4096];
+    DWORD i, j, next, start, end, count = 0;
+    int len, pos = 0;
+
+    for (p = filename; *p; p++) if (*p == '\\' || *p == '/') name = p + 1;
+    if ((len = ntdll_wcstoumbs( name, wcslen(name), module, sizeof(module) - 1, FALSE )) < 0) return;
+    module[len] = 0;
+
+    symbols = get_perf_symbols( ptr, total_size, nt, sections, &count );
+
+    for (i = 0, sec = sections; i < nt->FileHeader.NumberOfSections; i++, sec++)
+    {
+        if (!(sec->Characteristics & IMAGE_SCN_MEM_EXECUTE)) continue;
+        start = sec->VirtualAddress;
+        end = start + max( sec->Misc.VirtualSize, sec->SizeOfRawData );
+        if (start >= total_size || end > total_size || end <= start) continue;
+
+        /* skip to the first export in this section */
+        for (j = 0; j < count && symbols[j].rva < start; j++) ;
+
+        next = (j < count && symbols[j].rva < end) ? symbols[j].rva : end;
+        if (next > start)
+            pos += snprintf( buffer + pos, sizeof(buffer) - pos, "%lx %x %s!%.8s\n",
+                             (unsigned long)(ptr + start), next - start, module, sec->Name );
+
+        while (j < count && symbols[j].rva < end)
+        {
+            const struct perf_symbol *sym = &symbols[j];
+
+            /* skip other exports aliasing the same address */
+            while (++j < count && symbols[j].rva == sym->rva) ;
+            next = (j < count && symbols[j].rva < end) ? symbols[j].rva : end;
+
+            if (pos > sizeof(buffer) - 1024)
+            {
+                write( perf_map_fd, buffer, pos );
+                pos = 0;
+            }
+            if (sym->name)
+                pos += snprintf( buffer + pos, sizeof(buffer) - pos, "%lx %x %s!%s\n",
+                                 (unsigned long)(ptr + sym->rva), next - sym->rva, module, sym->name );
+            else
+                pos += snprintf( buffer + pos, sizeof(buffer) - pos, "%lx %x %s!%.8s+0x%x\n",
+                                 (unsigned long)(ptr + sym->rva), next - sym->rva, module, sec->Name,
+                                 sym->rva - start );
+        }
+        if (pos > sizeof(buffer) - 1024)
+        {
+            write( perf_map_fd, buffer, pos );
+            pos = 0;
+        }
+    }
+    if (pos) write( perf_map_fd, buffer, pos );
+    free( symbols );
+}
+
+
 /***********************************************************************
  *           map_image_into_view
  *
@@ -2419,6 +2577,8 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
                  sec->Characteristics, debugstr_w(filename), sec->Name );
     }
 
+    if (perf_map_fd != -1) perf_map_image( ptr, total_size, filename, nt, sections );
+
 #ifdef VALGRIND_LOAD_PDB_DEBUGINFO
     VALGRIND_LOAD_PDB_DEBUGINFO(fd, ptr, total_size, ptr - (char *)orig_base);
 #endif
@@ -2735,6 +2895,16 @@ void virtual_init(void)
         }
     }
 
+    if (getenv( "WINEPERFMAP" ))
+    {
+        char name[32];
+        sprintf( name, "/tmp/perf-%d.map", getpid() );
+        if ((perf_map_fd = open( name, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644 )) != -1)
+            fcntl( perf_map_fd, F_SETFD, FD_CLOEXEC );
+        else
+            WARN( "failed to create %s: %s\n", name, strerror(errno) );
+    }
+
     /* try to find space in a reserved area for the views and pages protection table */
 #ifdef _WIN64
     pages_vprot_size = ((size_t)address_space_limit >> page_shift >> pages_vprot_shift) + 1;
@@ -23,6 +23,9 @@
 #endif
 
 #include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -585,17 +588,206 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+/*
+ * Optional parallel rendering of large operations.
+ *
+ * When enabled with the WINE_DIB_THREADS environment variable, operations covering more
+ * than band_min_pixels are split in horizontal bands that are rendered concurrently by
+ * the calling thread and a small pool of worker threads. Each band only touches its own
+ * destination rows, so the result is identical to the serial one.
+ */
+
+#define MAX_BAND_THREADS 16
+
+struct band_job
+{
+    BOOL      (*func)( void *ctx, const RECT *rects, int count, const RECT *band );
+    void       *ctx;
+    const RECT *rects;        /* clipped rectangles */
+    int         count;        /* number of rectangles */
+    int         top;          /* top of the first band */
+    int         bottom;       /* bottom of the last band */
+    int         band_height;  /* height of a single band */
+    LONG        next_band;    /* index of the next band to render */
+    int         pending;      /* number of workers that haven't finished the job */
+    LONG        failed;       /* a band failed, the remaining ones are skipped */
+};
+
+static const unsigned int band_min_pixels = 512 * 512;
+static pthread_once_t band_init_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t band_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t band_start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t band_done_cond = PTHREAD_COND_INITIALIZER;
+static struct band_job *band_job;        /* job currently being rendered */
+static unsigned int band_generation;     /* incremented for every job */
+static unsigned int band_workers;        /* number of worker threads */
+static BOOL band_busy;
+
+static void render_bands( struct band_job *job )
+{
+    RECT band;
+    int i;
+
+    band.left  = INT_MIN;
+    band.right = INT_MAX;
+    while (!job->failed &&
+           (i = InterlockedIncrement( &job->next_band ) - 1) * job->band_height < job->bottom - job->top)
+    {
+        band.top    = job->top + i * job->band_height;
+        band.bottom = min( band.top + job->band_height, job->bottom );
+        if (!job->func( job->ctx, job->rects, job->count, &band ))
+            InterlockedExchange( &job->failed, TRUE );
+    }
+}
+
+static void *band_worker( void *arg )
+{
+    unsigned int generation = 0;
+    struct band_job *job;
+
+    pthread_mutex_lock( &band_mutex );
+    for (;;)
+    {
+        while (generation == band_generation) pthread_cond_wait( &band_start_cond, &band_mutex );
+        generation = band_generation;
+        job = band_job;
+        pthread_mutex_unlock( &band_mutex );
+
+        render_bands( job );
+
+        pthread_mutex_lock( &band_mutex );
+        if (!--job->pending) pthread_cond_signal( &band_done_cond );
+    }
+    return NULL;
+}
+
+static void init_band_workers(void)
+{
+    const char *env = getenv( "WINE_DIB_THREADS" );
+    unsigned int i, count;
+    sigset_t all_signals, old_signals;
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    if (!env || (count = atoi( env )) < 2) return;
+    count = min( count, MAX_BAND_THREADS );
+
+    /* signals are meant for Wine threads, keep them away from the workers */
+    sigfillset( &all_signals );
+    pthread_sigmask( SIG_BLOCK, &all_signals, &old_signals );
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    for (i = 0; i < count - 1; i++)
+        if (!pthread_create( &thread, &attr, band_worker, NULL )) band_workers++;
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_signals, NULL );
+
+    TRACE( "using %u worker threads\n", band_workers );
+}
+
+/* call func for all the clipped rectangles, possibly splitting them in bands rendered in parallel */
+static BOOL render_clipped_rects( const struct clipped_rects *clipped_rects,
+                                  BOOL (*func)( void *ctx, const RECT *rects, int count, const RECT *band ),
+                                  void *ctx )
+{
+    struct band_job job;
+    unsigned long long pixels = 0;
+    int i;
+
+    if (!clipped_rects->count) return TRUE;
+
+    pthread_once( &band_init_once, init_band_workers );
+
+    job.top    = clipped_rects->rects[0].top;
+    job.bottom = clipped_rects->rects[0].bottom;
+    for (i = 0; i < clipped_rects->count; i++)
+    {
+        const RECT *rc = &clipped_rects->rects[i];
+        pixels += (unsigned long long)(rc->right - rc->left) * (rc->bottom - rc->top);
+        job.top    = min( job.top, rc->top );
+        job.bottom = max( job.bottom, rc->bottom );
+    }
+
+    if (band_workers && pixels >= band_min_pixels)
+    {
+        pthread_mutex_lock( &band_mutex );
+        if (!band_busy)
+        {
+            band_busy = TRUE;
+            job.func        = func;
+            job.ctx         = ctx;
+            job.rects       = clipped_rects->rects;
+            job.count       = clipped_rects->count;
+            job.band_height = max( 16, (job.bottom - job.top) / ((band_workers + 1) * 4) );
+            job.next_band   = 0;
+            job.pending     = band_workers;
+            job.failed      = FALSE;
+            band_job = &job;
+            band_generation++;
+            pthread_cond_broadcast( &band_start_cond );
+            pthread_mutex_unlock( &band_mutex );
+
+            render_bands( &job );
+
+            pthread_mutex_lock( &band_mutex );
+            while (job.pending) pthread_cond_wait( &band_done_cond, &band_mutex );
+            band_job = NULL;
+            band_busy = FALSE;
+            pthread_mutex_unlock( &band_mutex );
+            return !job.failed;
+        }
+        pthread_mutex_unlock( &band_mutex );
+    }
+
+    return func( ctx, clipped_rects->rects, clipped_rects->count, NULL );
+}
+
+struct blend_rect_params
+{
+    dib_info      *dst;
+    const dib_info *src;
+    POINT          offset;
+    BLENDFUNCTION  blend;
+};
+
+static BOOL blend_rects_band( void *ctx, const RECT *rects, int count, const RECT *band )
+{
+    struct blend_rect_params *params = ctx;
+    RECT rc;
+    int i;
+
+    if (!band)
+    {
+        params->dst->funcs->blend_rects( params->dst, count, rects, params->src, &params->offset, params->blend );
+        return TRUE;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (!intersect_rect( &rc, &rects[i], band )) continue;
+        params->dst->funcs->blend_rects( params->dst, 1, &rc, params->src, &params->offset, params->blend );
+    }
+    return TRUE;
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
-    POINT offset;
+    struct blend_rect_params params;
     struct clipped_rects clipped_rects;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
 
-    offset.x = src_rect->left - dst_rect->left;
-    offset.y = src_rect->top  - dst_rect->top;
-    dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
+    params.dst      = dst;
+    params.src      = src;
+    params.offset.x = src_rect->left - dst_rect->left;
+    params.offset.y = src_rect->top  - dst_rect->top;
+    params.blend    = blend;
+
+    /* source rows may be overwritten by other bands when blending to the same bitmap */
+    if (src->bits.ptr == dst->bits.ptr)
+        blend_rects_band( &params, clipped_rects.rects, clipped_rects.count, NULL );
+    else
+        render_clipped_rects( &clipped_rects, blend_rects_band, &params );
 
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -680,17 +872,41 @@ static void get_gradient_triangle_vertices( const GRADIENT_TRIANGLE *tri, const
     bounds->bottom = v[2].y;
 }
 
-static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
+struct gradient_rect_params
+{
+    dib_info *dib;
+    TRIVERTEX *v;
+    int        mode;
+};
+
+static BOOL gradient_rects_band( void *ctx, const RECT *rects, int count, const RECT *band )
 {
+    struct gradient_rect_params *params = ctx;
+    RECT rc;
     int i;
-    struct clipped_rects clipped_rects;
-    BOOL ret = TRUE;
 
-    if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
-    for (i = 0; i < clipped_rects.count; i++)
+    for (i = 0; i < count; i++)
     {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        if (band && !intersect_rect( &rc, &rects[i], band )) continue;
+        if (!params->dib->funcs->gradient_rect( params->dib, band ? &rc : &rects[i], params->v, params->mode ))
+            return FALSE;
     }
+    return TRUE;
+}
+
+static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
+{
+    struct gradient_rect_params params;
+    struct clipped_rects clipped_rects;
+    BOOL ret;
+
+    if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
+
+    params.dib  = dib;
+    params.v    = v;
+    params.mode = mode;
+    ret = render_clipped_rects( &clipped_rects, gradient_rects_band, &params );
+
     free_clipped_rects( &clipped_rects );
     return ret;
 }
@@ -23,6 +23,9 @@
 #endif
 
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -4664,6 +4667,76 @@ static inline DWORD blend_argb_alpha( DWORD dst, DWORD src, DWORD alpha )
             (alpha + ((BYTE)(dst >> 24) * (255 - alpha) + 127) / 255) << 24);
 }
 
+#ifdef __SSE2__
+
+/* divide unsigned 16-bit lanes by 255, exact for values up to 255 * 255 + 127 */
+static inline __m128i div255_epu16( __m128i x )
+{
+    return _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( x, _mm_set1_epi16( 1 ) ), _mm_srli_epi16( x, 8 ) ), 8 );
+}
+
+/* same as blend_argb on two pixels unpacked to 16-bit lanes, without saturation */
+static inline __m128i blend_argb_2px( __m128i dst, __m128i src )
+{
+    __m128i alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( src, 0xff ), 0xff );
+
+    dst = _mm_mullo_epi16( dst, _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha ) );
+    return _mm_add_epi16( src, div255_epu16( _mm_add_epi16( dst, _mm_set1_epi16( 127 ) ) ) );
+}
+
+static inline __m128i scale_argb_2px( __m128i src, __m128i alpha )
+{
+    return div255_epu16( _mm_add_epi16( _mm_mullo_epi16( src, alpha ), _mm_set1_epi16( 127 ) ) );
+}
+
+#endif
+
+/* blend a row of premultiplied ARGB pixels, with a constant alpha applied on top */
+static void blend_argb_row( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    /* process pixels by groups of 4, unless the rows overlap */
+    if (dst + len <= src || src + len <= dst)
+    {
+        const __m128i zero = _mm_setzero_si128(), max = _mm_set1_epi16( 255 );
+        const __m128i const_alpha = _mm_set1_epi16( alpha );
+
+        for ( ; x + 4 <= len; x += 4)
+        {
+            __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+            __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+            __m128i s_lo = _mm_unpacklo_epi8( s, zero ), s_hi = _mm_unpackhi_epi8( s, zero );
+            __m128i lo, hi;
+            int i;
+
+            if (alpha != 255)
+            {
+                s_lo = scale_argb_2px( s_lo, const_alpha );
+                s_hi = scale_argb_2px( s_hi, const_alpha );
+            }
+            lo = blend_argb_2px( _mm_unpacklo_epi8( d, zero ), s_lo );
+            hi = blend_argb_2px( _mm_unpackhi_epi8( d, zero ), s_hi );
+
+            /* channels only overflow with invalid premultiplied data, where carries
+             * propagate to the next channel; leave that case to the scalar code */
+            if (!_mm_movemask_epi8( _mm_cmpgt_epi16( _mm_or_si128( lo, hi ), max ) ))
+                _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( lo, hi ) );
+            else if (alpha == 255)
+                for (i = x; i < x + 4; i++) dst[i] = blend_argb( dst[i], src[i] );
+            else
+                for (i = x; i < x + 4; i++) dst[i] = blend_argb_alpha( dst[i], src[i], alpha );
+        }
+    }
+#endif
+
+    if (alpha == 255)
+        for ( ; x < len; x++) dst[x] = blend_argb( dst[x], src[x] );
+    else
+        for ( ; x < len; x++) dst[x] = blend_argb_alpha( dst[x], src[x], alpha );
+}
+
 static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BLENDFUNCTION blend )
 {
     if (blend.AlphaFormat & AC_SRC_ALPHA)
@@ -4693,16 +4766,8 @@ static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
         DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
 
         if (blend.AlphaFormat & AC_SRC_ALPHA)
-        {
-            if (blend.SourceConstantAlpha == 255)
-                for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
-            else
-                for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
-        }
+            for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+                blend_argb_row( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha );
         else if (src->compression == BI_RGB)
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
                 for (x = 0; x < rc->right - rc->left; x++)
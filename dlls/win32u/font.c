@@ -2027,6 +2027,39 @@ static struct gdi_font *alloc_gdi_font( const WCHAR *file, void *data_ptr, SIZE_
     return font;
 }
 
+struct glyph_metrics
+{
+    GLYPHMETRICS gm;
+    ABC          abc;  /* metrics of the unrotated char */
+    LONG         init;
+};
+
+#define GM_BLOCK_SIZE 128
+
+/* Tables are only replaced by larger copies while holding the font lock; the
+ * previous ones are kept until the font is freed, so that readers don't need
+ * to take the lock. */
+struct glyph_metrics_table
+{
+    struct glyph_metrics_table *prev;
+    UINT                        size;
+    struct glyph_metrics       *blocks[1];
+};
+
+static void free_glyph_metrics_table( struct glyph_metrics_table *table )
+{
+    struct glyph_metrics_table *prev;
+    UINT i;
+
+    if (!table) return;
+    for (i = 0; i < table->size; i++) free( table->blocks[i] );
+    for (; table; table = prev)
+    {
+        prev = table->prev;
+        free( table );
+    }
+}
+
 static void free_gdi_font( struct gdi_font *font )
 {
     DWORD i;
@@ -2039,12 +2072,11 @@ static void free_gdi_font( struct gdi_font *font )
         list_remove( &child->entry );
         free_gdi_font( child );
     }
-    for (i = 0; i < font->gm_size; i++) free( font->gm[i] );
+    for (i = 0; i < ARRAY_SIZE(font->gm); i++) free_glyph_metrics_table( font->gm[i] );
     free( font->otm.otmpFamilyName );
     free( font->otm.otmpStyleName );
     free( font->otm.otmpFaceName );
     free( font->otm.otmpFullName );
-    free( font->gm );
     free( font->kern_pairs );
     free( font->gsub_table );
     free( font );
@@ -2076,58 +2108,58 @@ static struct gdi_font *create_gdi_font( const struct gdi_font_face *face, const
     return font;
 }
 
-struct glyph_metrics
-{
-    GLYPHMETRICS gm;
-    ABC          abc;  /* metrics of the unrotated char */
-    BOOL         init;
-};
-
-#define GM_BLOCK_SIZE 128
-
 /* TODO: GGO format support */
-static BOOL get_gdi_font_glyph_metrics( struct gdi_font *font, UINT index, GLYPHMETRICS *gm, ABC *abc )
+static BOOL get_gdi_font_glyph_metrics( struct gdi_font *font, BOOL glyph_index, UINT index,
+                                        GLYPHMETRICS *gm, ABC *abc )
 {
+    /* pairs with the release stores in set_gdi_font_glyph_metrics */
+    struct glyph_metrics_table *table = __atomic_load_n( &font->gm[!!glyph_index], __ATOMIC_ACQUIRE );
     UINT block = index / GM_BLOCK_SIZE;
-    UINT entry = index % GM_BLOCK_SIZE;
+    struct glyph_metrics *metrics;
 
-    if (block < font->gm_size && font->gm[block] && font->gm[block][entry].init)
-    {
-        *gm  = font->gm[block][entry].gm;
-        *abc = font->gm[block][entry].abc;
+    if (!table || block >= table->size) return FALSE;
+    if (!(metrics = __atomic_load_n( &table->blocks[block], __ATOMIC_ACQUIRE ))) return FALSE;
+    metrics += index % GM_BLOCK_SIZE;
+    if (!__atomic_load_n( &metrics->init, __ATOMIC_ACQUIRE )) return FALSE;
 
-        TRACE( "cached gm: %u, %u, %s, %d, %d abc: %d, %u, %d\n",
-               gm->gmBlackBoxX, gm->gmBlackBoxY, wine_dbgstr_point( &gm->gmptGlyphOrigin ),
-               gm->gmCellIncX, gm->gmCellIncY, abc->abcA, abc->abcB, abc->abcC );
-        return TRUE;
-    }
+    *gm  = metrics->gm;
+    *abc = metrics->abc;
 
-    return FALSE;
+    TRACE( "cached gm: %u, %u, %s, %d, %d abc: %d, %u, %d\n",
+           gm->gmBlackBoxX, gm->gmBlackBoxY, wine_dbgstr_point( &gm->gmptGlyphOrigin ),
+           gm->gmCellIncX, gm->gmCellIncY, abc->abcA, abc->abcB, abc->abcC );
+    return TRUE;
 }
 
-static void set_gdi_font_glyph_metrics( struct gdi_font *font, UINT index,
+/* must be called with the font lock held */
+static void set_gdi_font_glyph_metrics( struct gdi_font *font, BOOL glyph_index, UINT index,
                                         const GLYPHMETRICS *gm, const ABC *abc )
 {
+    struct glyph_metrics_table *table = font->gm[!!glyph_index], *new_table;
     UINT block = index / GM_BLOCK_SIZE;
-    UINT entry = index % GM_BLOCK_SIZE;
+    struct glyph_metrics *metrics;
+    UINT size;
 
-    if (block >= font->gm_size)
+    if (!table || block >= table->size)
     {
-        struct glyph_metrics **ptr;
-
-        if (!(ptr = realloc( font->gm, (block + 1) * sizeof(*ptr) ))) return;
-        memset( ptr + font->gm_size, 0, (block + 1 - font->gm_size) * sizeof(*ptr) );
-        font->gm_size = block + 1;
-        font->gm = ptr;
+        for (size = table ? table->size : 1; size <= block; size *= 2) ;
+        if (!(new_table = calloc( 1, offsetof( struct glyph_metrics_table, blocks[size] ) ))) return;
+        new_table->size = size;
+        new_table->prev = table;
+        if (table) memcpy( new_table->blocks, table->blocks, table->size * sizeof(*table->blocks) );
+        __atomic_store_n( &font->gm[!!glyph_index], new_table, __ATOMIC_RELEASE );
+        table = new_table;
     }
-    if (!font->gm[block])
+    if (!(metrics = table->blocks[block]))
     {
-        font->gm[block] = calloc( sizeof(**font->gm), GM_BLOCK_SIZE );
-        if (!font->gm[block]) return;
+        if (!(metrics = calloc( GM_BLOCK_SIZE, sizeof(*metrics) ))) return;
+        __atomic_store_n( &table->blocks[block], metrics, __ATOMIC_RELEASE );
     }
-    font->gm[block][entry].gm   = *gm;
-    font->gm[block][entry].abc  = *abc;
-    font->gm[block][entry].init = TRUE;
+    metrics += index % GM_BLOCK_SIZE;
+    if (metrics->init) return;  /* may be concurrently read */
+    metrics->gm  = *gm;
+    metrics->abc = *abc;
+    __atomic_store_n( &metrics->init, TRUE, __ATOMIC_RELEASE );
 }
 
 
@@ -3407,11 +3439,19 @@ static DWORD get_glyph_outline( struct gdi_font *font, UINT glyph, UINT format,
                                 GLYPHMETRICS *gm_ret, ABC *abc_ret, DWORD buflen, void *buf,
                                 const MAT2 *mat )
 {
+    struct gdi_font *glyph_font = font;
     GLYPHMETRICS gm;
     ABC abc;
     DWORD ret = 1;
     UINT index = glyph;
     BOOL tategaki = (*get_gdi_font_name( font ) == '@');
+    BOOL glyph_index = !!(format & GGO_GLYPH_INDEX);
+
+    if (mat && !memcmp( mat, &identity, sizeof(*mat) )) mat = NULL;
+
+    if ((format & ~GGO_GLYPH_INDEX) == GGO_METRICS && !mat &&
+        get_gdi_font_glyph_metrics( font, glyph_index, glyph, &gm, &abc ))
+        goto done;
 
     if (format & GGO_GLYPH_INDEX)
     {
@@ -3425,25 +3465,21 @@ static DWORD get_glyph_outline( struct gdi_font *font, UINT glyph, UINT format,
     }
     else
     {
-        index = get_glyph_index_linked( &font, glyph );
+        index = get_glyph_index_linked( &glyph_font, glyph );
         if (tategaki)
         {
             UINT orig = index;
-            index = get_GSUB_vert_glyph( font, index );
+            index = get_GSUB_vert_glyph( glyph_font, index );
             if (index == orig) tategaki = check_unicode_tategaki( glyph );
         }
     }
 
-    if (mat && !memcmp( mat, &identity, sizeof(*mat) )) mat = NULL;
-
-    if (format == GGO_METRICS && !mat && get_gdi_font_glyph_metrics( font, index, &gm, &abc ))
-        goto done;
-
-    ret = font_funcs->get_glyph_outline( font, index, format, &gm, &abc, buflen, buf, mat, tategaki );
+    ret = font_funcs->get_glyph_outline( glyph_font, index, format, &gm, &abc, buflen, buf, mat, tategaki );
     if (ret == GDI_ERROR) return ret;
 
+    /* metrics are cached in the font that was requested, even for linked glyphs */
     if ((format == GGO_METRICS || format == GGO_BITMAP || format ==  WINE_GGO_GRAY16_BITMAP) && !mat)
-        set_gdi_font_glyph_metrics( font, index, &gm, &abc );
+        set_gdi_font_glyph_metrics( font, glyph_index, glyph, &gm, &abc );
 
 done:
     if (gm_ret) *gm_ret = gm;
@@ -3475,6 +3511,7 @@ static BOOL CDECL font_GetCharABCWidths( PHYSDEV dev, UINT first, UINT count,
                                          WCHAR *chars, ABC *buffer )
 {
     struct font_physdev *physdev = get_font_dev( dev );
+    GLYPHMETRICS gm;
     UINT c, i;
 
     if (!physdev->font)
@@ -3485,8 +3522,16 @@ static BOOL CDECL font_GetCharABCWidths( PHYSDEV dev, UINT first, UINT count,
 
     TRACE( "%p, %u, %u, %p\n", physdev->font, first, count, buffer );
 
-    pthread_mutex_lock( &font_lock );
     for (i = 0; i < count; i++)
+    {
+        c = chars ? chars[i] : first + i;
+        if (!get_gdi_font_glyph_metrics( physdev->font, FALSE, c, &gm, &buffer[i] )) break;
+    }
+    if (i == count) return TRUE;
+
+    /* compute the remaining metrics in a single pass under the lock */
+    pthread_mutex_lock( &font_lock );
+    for (; i < count; i++)
     {
         c = chars ? chars[i] : first + i;
         get_glyph_outline( physdev->font, c, GGO_METRICS, NULL, &buffer[i], 0, NULL, NULL );
@@ -3502,6 +3547,7 @@ static BOOL CDECL font_GetCharABCWidths( PHYSDEV dev, UINT first, UINT count,
 static BOOL CDECL font_GetCharABCWidthsI( PHYSDEV dev, UINT first, UINT count, WORD *gi, ABC *buffer )
 {
     struct font_physdev *physdev = get_font_dev( dev );
+    GLYPHMETRICS gm;
     UINT c;
 
     if (!physdev->font)
@@ -3512,8 +3558,12 @@ static BOOL CDECL font_GetCharABCWidthsI( PHYSDEV dev, UINT first, UINT count, W
 
     TRACE( "%p, %u, %u, %p\n", physdev->font, first, count, buffer );
 
-    pthread_mutex_lock( &font_lock );
     for (c = 0; c < count; c++, buffer++)
+        if (!get_gdi_font_glyph_metrics( physdev->font, TRUE, gi ? gi[c] : first + c, &gm, buffer )) break;
+    if (c == count) return TRUE;
+
+    pthread_mutex_lock( &font_lock );
+    for (; c < count; c++, buffer++)
         get_glyph_outline( physdev->font, gi ? gi[c] : first + c, GGO_METRICS | GGO_GLYPH_INDEX,
                            NULL, buffer, 0, NULL, NULL );
     pthread_mutex_unlock( &font_lock );
@@ -3528,6 +3578,7 @@ static BOOL CDECL font_GetCharWidth( PHYSDEV dev, UINT first, UINT count,
                                      const WCHAR *chars, INT *buffer )
 {
     struct font_physdev *physdev = get_font_dev( dev );
+    GLYPHMETRICS gm;
     UINT c, i;
     ABC abc;
 
@@ -3539,8 +3590,16 @@ static BOOL CDECL font_GetCharWidth( PHYSDEV dev, UINT first, UINT count,
 
     TRACE( "%p, %d, %d, %p\n", physdev->font, first, count, buffer );
 
-    pthread_mutex_lock( &font_lock );
     for (i = 0; i < count; i++)
+    {
+        c = chars ? chars[i] : i + first;
+        if (!get_gdi_font_glyph_metrics( physdev->font, FALSE, c, &gm, &abc )) break;
+        buffer[i] = abc.abcA + abc.abcB + abc.abcC;
+    }
+    if (i == count) return TRUE;
+
+    pthread_mutex_lock( &font_lock );
+    for (; i < count; i++)
     {
         c = chars ? chars[i] : i + first;
         if (get_glyph_outline( physdev->font, c, GGO_METRICS, NULL, &abc, 0, NULL, NULL ) == GDI_ERROR)
@@ -3888,6 +3947,7 @@ static UINT CDECL font_GetTextCharsetInfo( PHYSDEV dev, FONTSIGNATURE *fs, DWORD
 static BOOL CDECL font_GetTextExtentExPoint( PHYSDEV dev, const WCHAR *str, INT count, INT *dxs )
 {
     struct font_physdev *physdev = get_font_dev( dev );
+    GLYPHMETRICS gm;
     INT i, pos;
     ABC abc;
 
@@ -3899,8 +3959,16 @@ static BOOL CDECL font_GetTextExtentExPoint( PHYSDEV dev, const WCHAR *str, INT
 
     TRACE( "%p, %s, %d\n", physdev->font, debugstr_wn(str, count), count );
 
-    pthread_mutex_lock( &font_lock );
     for (i = pos = 0; i < count; i++)
+    {
+        if (!get_gdi_font_glyph_metrics( physdev->font, FALSE, str[i], &gm, &abc )) break;
+        pos += abc.abcA + abc.abcB + abc.abcC;
+        dxs[i] = pos;
+    }
+    if (i == count) return TRUE;
+
+    pthread_mutex_lock( &font_lock );
+    for (; i < count; i++)
     {
         get_glyph_outline( physdev->font, str[i], GGO_METRICS, NULL, &abc, 0, NULL, NULL );
         pos += abc.abcA + abc.abcB + abc.abcC;
@@ -3917,6 +3985,7 @@ static BOOL CDECL font_GetTextExtentExPoint( PHYSDEV dev, const WCHAR *str, INT
 static BOOL CDECL font_GetTextExtentExPointI( PHYSDEV dev, const WORD *indices, INT count, INT *dxs )
 {
     struct font_physdev *physdev = get_font_dev( dev );
+    GLYPHMETRICS gm;
     INT i, pos;
     ABC abc;
 
@@ -3928,8 +3997,16 @@ static BOOL CDECL font_GetTextExtentExPointI( PHYSDEV dev, const WORD *indices,
 
     TRACE( "%p, %p, %d\n", physdev->font, indices, count );
 
-    pthread_mutex_lock( &font_lock );
     for (i = pos = 0; i < count; i++)
+    {
+        if (!get_gdi_font_glyph_metrics( physdev->font, TRUE, indices[i], &gm, &abc )) break;
+        pos += abc.abcA + abc.abcB + abc.abcC;
+        dxs[i] = pos;
+    }
+    if (i == count) return TRUE;
+
+    pthread_mutex_lock( &font_lock );
+    for (; i < count; i++)
     {
         get_glyph_outline( physdev->font, indices[i], GGO_METRICS | GGO_GLYPH_INDEX,
                            NULL, &abc, 0, NULL, NULL );
@@ -1190,6 +1190,322 @@ struct unix_face
     struct bitmap_font_size size;
 };
 
+/* Persistent index of the font faces found at startup, stored in the prefix
+ * and validated against the FreeType version and the size and modification
+ * time of each font file. */
+
+#define FONT_INDEX_MAGIC   0x78646966  /* "fidx" */
+#define FONT_INDEX_VERSION 2
+
+#define FONT_INDEX_SCALABLE     0x0001
+#define FONT_INDEX_ALLOW_BITMAP 0x0002
+
+struct font_index_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD lcid;
+    DWORD count;
+    DWORD size;
+    DWORD ft_version;  /* FT_SimpleVersion, the parsed data depends on it */
+};
+
+/* the entries follow the header and contain 64-bit fields */
+C_ASSERT( sizeof(struct font_index_header) % 8 == 0 );
+
+struct font_index_entry
+{
+    UINT64 file_size;
+    UINT64 file_ino;
+    UINT64 file_mtime;
+    DWORD unix_name;  /* string offsets from the start of the file, 0 for none */
+    DWORD names[4];   /* family, second, style and full names */
+    DWORD face_index;
+    DWORD flags;
+    DWORD num_faces;
+    DWORD ntm_flags;
+    DWORD font_version;
+    FONTSIGNATURE fs;
+    struct bitmap_font_size size;
+};
+
+struct font_index_record
+{
+    struct font_index_entry entry;
+    char *unix_name;
+    WCHAR *names[4];
+};
+
+static struct
+{
+    BOOL active;
+    BOOL dirty;
+    char *path;
+    void *data;
+    size_t size;
+    const struct font_index_entry *entries;
+    UINT count;
+    UINT *hash;  /* open addressing, ~0u for empty slots */
+    UINT hash_size;
+    struct font_index_record *records;
+    UINT record_count;
+    UINT record_size;
+} font_index;
+
+static UINT hash_font_index_name( const char *unix_name, UINT face_index )
+{
+    UINT hash = 2166136261u ^ face_index;
+    while (*unix_name) hash = (hash ^ (unsigned char)*unix_name++) * 16777619u;
+    return hash;
+}
+
+static const char *get_font_index_string( DWORD offset )
+{
+    const char *str = (const char *)font_index.data + offset;
+
+    if (!offset || offset >= font_index.size) return NULL;
+    if (!memchr( str, 0, font_index.size - offset )) return NULL;
+    return str;
+}
+
+static const WCHAR *get_font_index_stringW( DWORD offset )
+{
+    const WCHAR *str = (const WCHAR *)((const char *)font_index.data + offset), *end;
+
+    if (!offset || offset >= font_index.size || (offset & 1)) return NULL;
+    end = (const WCHAR *)((const char *)font_index.data + (font_index.size & ~1));
+    while (str < end) if (!*str++) return (const WCHAR *)((const char *)font_index.data + offset);
+    return NULL;
+}
+
+static void load_font_index(void)
+{
+    const struct font_index_header *header;
+    const char *config_dir = ntdll_get_config_dir();
+    struct stat st;
+    UINT i, pos;
+    int fd;
+
+    memset( &font_index, 0, sizeof(font_index) );
+    if (!config_dir) return;
+    if (!(font_index.path = malloc( strlen( config_dir ) + sizeof("/.font-index") ))) return;
+    strcpy( font_index.path, config_dir );
+    strcat( font_index.path, "/.font-index" );
+    font_index.active = TRUE;
+    font_index.dirty = TRUE;
+
+    if ((fd = open( font_index.path, O_RDONLY )) == -1) return;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) || st.st_size > 0x7fffffff)
+    {
+        close( fd );
+        return;
+    }
+    font_index.size = st.st_size;
+    font_index.data = mmap( NULL, font_index.size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (font_index.data == MAP_FAILED)
+    {
+        font_index.data = NULL;
+        return;
+    }
+
+    header = font_index.data;
+    if (header->magic != FONT_INDEX_MAGIC || header->version != FONT_INDEX_VERSION ||
+        header->lcid != system_lcid || header->size != font_index.size ||
+        header->ft_version != FT_SimpleVersion ||
+        header->count > (font_index.size - sizeof(*header)) / sizeof(*font_index.entries))
+    {
+        TRACE( "ignoring outdated font index %s\n", debugstr_a(font_index.path) );
+        return;
+    }
+
+    font_index.entries = (const struct font_index_entry *)(header + 1);
+    for (font_index.hash_size = 16; font_index.hash_size < header->count * 2; font_index.hash_size *= 2) ;
+    if (!(font_index.hash = malloc( font_index.hash_size * sizeof(*font_index.hash) ))) return;
+    memset( font_index.hash, 0xff, font_index.hash_size * sizeof(*font_index.hash) );
+
+    for (i = 0; i < header->count; i++)
+    {
+        const char *unix_name = get_font_index_string( font_index.entries[i].unix_name );
+
+        if (!unix_name) continue;
+        pos = hash_font_index_name( unix_name, font_index.entries[i].face_index ) & (font_index.hash_size - 1);
+        while (font_index.hash[pos] != ~0u) pos = (pos + 1) & (font_index.hash_size - 1);
+        font_index.hash[pos] = i;
+    }
+    font_index.count = header->count;
+    font_index.dirty = FALSE;
+    TRACE( "loaded %u faces from %s\n", font_index.count, debugstr_a(font_index.path) );
+}
+
+static void record_font_index_face( const char *unix_name, UINT face_index, DWORD flags,
+                                    const struct stat *st, const struct unix_face *face )
+{
+    struct font_index_record *record;
+    const WCHAR *names[4] = { face->family_name, face->second_name, face->style_name, face->full_name };
+    UINT i;
+
+    if (font_index.record_count == font_index.record_size)
+    {
+        UINT size = max( 64, font_index.record_size * 2 );
+        if (!(record = realloc( font_index.records, size * sizeof(*record) ))) return;
+        font_index.records = record;
+        font_index.record_size = size;
+    }
+    record = &font_index.records[font_index.record_count];
+    memset( record, 0, sizeof(*record) );
+
+    if (!(record->unix_name = strdup( unix_name ))) return;
+    for (i = 0; i < ARRAY_SIZE(names); i++)
+        if (names[i]) record->names[i] = strdupW( names[i] );
+
+    record->entry.file_size = st->st_size;
+    record->entry.file_ino = st->st_ino;
+    record->entry.file_mtime = st->st_mtime;
+    record->entry.face_index = face_index;
+    if (face->scalable) record->entry.flags |= FONT_INDEX_SCALABLE;
+    if (flags & ADDFONT_ALLOW_BITMAP) record->entry.flags |= FONT_INDEX_ALLOW_BITMAP;
+    record->entry.num_faces = face->num_faces;
+    record->entry.ntm_flags = face->ntm_flags;
+    record->entry.font_version = face->font_version;
+    record->entry.fs = face->fs;
+    record->entry.size = face->size;
+    font_index.record_count++;
+}
+
+static struct unix_face *get_indexed_unix_face( const char *unix_name, UINT face_index, DWORD flags,
+                                                const struct stat *st )
+{
+    const struct font_index_entry *entry = NULL;
+    struct unix_face *face;
+    const char *name;
+    const WCHAR *str;
+    UINT pos, i;
+
+    if (!font_index.hash) return NULL;
+
+    pos = hash_font_index_name( unix_name, face_index ) & (font_index.hash_size - 1);
+    for (; font_index.hash[pos] != ~0u; pos = (pos + 1) & (font_index.hash_size - 1))
+    {
+        entry = &font_index.entries[font_index.hash[pos]];
+        if (entry->face_index == face_index && (name = get_font_index_string( entry->unix_name )) &&
+            !strcmp( name, unix_name )) break;
+        entry = NULL;
+    }
+    if (!entry) return NULL;
+
+    if (entry->file_size != st->st_size || entry->file_ino != st->st_ino || entry->file_mtime != st->st_mtime)
+        return NULL;
+    /* bitmap fonts are only loaded when explicitly allowed */
+    if (!(entry->flags & FONT_INDEX_SCALABLE) && !(entry->flags & FONT_INDEX_ALLOW_BITMAP) != !(flags & ADDFONT_ALLOW_BITMAP))
+        return NULL;
+    if (!(str = get_font_index_stringW( entry->names[0] ))) return NULL;
+
+    if (!(face = calloc( 1, sizeof(*face) ))) return NULL;
+    face->scalable = !!(entry->flags & FONT_INDEX_SCALABLE);
+    face->num_faces = entry->num_faces;
+    face->ntm_flags = entry->ntm_flags;
+    face->font_version = entry->font_version;
+    face->fs = entry->fs;
+    face->size = entry->size;
+    face->family_name = strdupW( str );
+    for (i = 1; i < ARRAY_SIZE(entry->names); i++)
+    {
+        WCHAR **dst = i == 1 ? &face->second_name : i == 2 ? &face->style_name : &face->full_name;
+        if ((str = get_font_index_stringW( entry->names[i] ))) *dst = strdupW( str );
+    }
+    return face;
+}
+
+static void save_font_index(void)
+{
+    struct font_index_header header;
+    struct font_index_entry *entries;
+    char *buffer, *tmp_path;
+    DWORD size, pos, len;
+    UINT i, j;
+    int fd;
+
+    if (!font_index.path) return;
+    if (!font_index.dirty && font_index.record_count == font_index.count) return;
+
+    /* WCHAR strings first to keep them aligned, then the file names */
+    size = sizeof(header) + font_index.record_count * sizeof(*entries);
+    for (i = 0; i < font_index.record_count; i++)
+    {
+        for (j = 0; j < ARRAY_SIZE(font_index.records[i].names); j++)
+            if (font_index.records[i].names[j])
+                size += (lstrlenW( font_index.records[i].names[j] ) + 1) * sizeof(WCHAR);
+        size += strlen( font_index.records[i].unix_name ) + 1;
+    }
+    if (!(buffer = calloc( 1, size ))) return;
+
+    entries = (struct font_index_entry *)(buffer + sizeof(header));
+    pos = sizeof(header) + font_index.record_count * sizeof(*entries);
+    for (i = 0; i < font_index.record_count; i++)
+    {
+        entries[i] = font_index.records[i].entry;
+        for (j = 0; j < ARRAY_SIZE(font_index.records[i].names); j++)
+        {
+            if (!font_index.records[i].names[j]) continue;
+            len = (lstrlenW( font_index.records[i].names[j] ) + 1) * sizeof(WCHAR);
+            memcpy( buffer + pos, font_index.records[i].names[j], len );
+            entries[i].names[j] = pos;
+            pos += len;
+        }
+    }
+    for (i = 0; i < font_index.record_count; i++)
+    {
+        len = strlen( font_index.records[i].unix_name ) + 1;
+        memcpy( buffer + pos, font_index.records[i].unix_name, len );
+        entries[i].unix_name = pos;
+        pos += len;
+    }
+
+    header.magic = FONT_INDEX_MAGIC;
+    header.version = FONT_INDEX_VERSION;
+    header.lcid = system_lcid;
+    header.count = font_index.record_count;
+    header.size = size;
+    header.ft_version = FT_SimpleVersion;
+    memcpy( buffer, &header, sizeof(header) );
+
+    /* write to a temporary file so that other processes never see a partial index */
+    if ((tmp_path = malloc( strlen( font_index.path ) + 12 )))
+    {
+        sprintf( tmp_path, "%s.%u", font_index.path, (unsigned int)getpid() );
+        if ((fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666 )) != -1)
+        {
+            BOOL ret = write( fd, buffer, size ) == size;
+            close( fd );
+            if (!ret || rename( tmp_path, font_index.path ) == -1)
+            {
+                WARN( "failed to write %s\n", debugstr_a(font_index.path) );
+                unlink( tmp_path );
+            }
+            else TRACE( "saved %u faces to %s\n", header.count, debugstr_a(font_index.path) );
+        }
+        free( tmp_path );
+    }
+    free( buffer );
+}
+
+static void free_font_index(void)
+{
+    UINT i, j;
+
+    for (i = 0; i < font_index.record_count; i++)
+    {
+        free( font_index.records[i].unix_name );
+        for (j = 0; j < ARRAY_SIZE(font_index.records[i].names); j++) free( font_index.records[i].names[j] );
+    }
+    free( font_index.records );
+    free( font_index.hash );
+    free( font_index.path );
+    if (font_index.data) munmap( font_index.data, font_index.size );
+    memset( &font_index, 0, sizeof(font_index) );
+}
+
 static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr, DWORD data_size,
                                            UINT face_index, DWORD flags )
 {
@@ -1207,6 +1523,12 @@ static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr
 
     if (unix_name)
     {
+        if (font_index.active && !stat( unix_name, &st ) &&
+            (This = get_indexed_unix_face( unix_name, face_index, flags, &st )))
+        {
+            record_font_index_face( unix_name, face_index, flags, &st, This );
+            return This;
+        }
         if ((fd = open( unix_name, O_RDONLY )) == -1) return NULL;
         if (fstat( fd, &st ) == -1)
         {
@@ -1302,7 +1624,15 @@ static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr
     }
 
 done:
-    if (unix_name) munmap( data_ptr, data_size );
+    if (unix_name)
+    {
+        munmap( data_ptr, data_size );
+        if (This && font_index.active)
+        {
+            record_font_index_face( unix_name, face_index, flags, &st, This );
+            font_index.dirty = TRUE;
+        }
+    }
     return This;
 }
 
@@ -1934,7 +2264,10 @@ sym_not_found:
 static void freetype_load_fonts(void)
 {
 #ifdef SONAME_LIBFONTCONFIG
+    load_font_index();
     load_fontconfig_fonts();
+    save_font_index();
+    free_font_index();
 #elif defined(HAVE_CARBON_CARBON_H)
     load_mac_fonts();
 #elif defined(__ANDROID__)
@@ -240,8 +240,7 @@ struct gdi_font
     struct list            entry;
     struct list            unused_entry;
     DWORD                  refcount;
-    DWORD                  gm_size;
-    struct glyph_metrics **gm;
+    struct glyph_metrics_table *gm[2]; /* indexed by character and by glyph index, read without locking */
     OUTLINETEXTMETRICW     otm;
     KERNINGPAIR           *kern_pairs;
     int                    kern_count;
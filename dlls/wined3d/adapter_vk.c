@@ -397,6 +397,104 @@ static const struct wined3d_allocator_ops wined3d_allocator_vk_ops =
     .allocator_destroy_chunk = wined3d_allocator_vk_destroy_chunk,
 };
 
+static void wined3d_device_vk_get_pipeline_cache_path(char *path, size_t size)
+{
+    snprintf(path, size, "%s\\pipeline_cache.vk", wined3d_settings.shader_cache_path);
+}
+
+static void wined3d_device_vk_create_pipeline_cache(struct wined3d_device_vk *device_vk)
+{
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+    VkPipelineCacheCreateInfo cache_info;
+    LARGE_INTEGER file_size;
+    char path[MAX_PATH];
+    void *data = NULL;
+    HANDLE file;
+    DWORD read;
+    VkResult vr;
+
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.pNext = NULL;
+    cache_info.flags = 0;
+    cache_info.initialDataSize = 0;
+    cache_info.pInitialData = NULL;
+
+    if (wined3d_settings.shader_cache_path)
+    {
+        wined3d_device_vk_get_pipeline_cache_path(path, sizeof(path));
+        if ((file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                NULL, OPEN_EXISTING, 0, NULL)) != INVALID_HANDLE_VALUE)
+        {
+            if (GetFileSizeEx(file, &file_size) && file_size.QuadPart && file_size.QuadPart < 0x40000000
+                    && (data = heap_alloc(file_size.QuadPart)))
+            {
+                if (ReadFile(file, data, file_size.QuadPart, &read, NULL) && read == file_size.QuadPart)
+                {
+                    cache_info.initialDataSize = read;
+                    cache_info.pInitialData = data;
+                }
+            }
+            CloseHandle(file);
+        }
+    }
+
+    /* Incompatible initial data is ignored by the implementation. */
+    if ((vr = VK_CALL(vkCreatePipelineCache(device_vk->vk_device, &cache_info, NULL,
+            &device_vk->vk_pipeline_cache))) < 0)
+    {
+        WARN("Failed to create pipeline cache, vr %s.\n", wined3d_debug_vkresult(vr));
+        device_vk->vk_pipeline_cache = VK_NULL_HANDLE;
+    }
+    else if (cache_info.initialDataSize)
+    {
+        TRACE("Loaded %lu bytes of pipeline cache data from %s.\n",
+                (unsigned long)cache_info.initialDataSize, debugstr_a(path));
+    }
+    heap_free(data);
+}
+
+static void wined3d_device_vk_destroy_pipeline_cache(struct wined3d_device_vk *device_vk)
+{
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+    char path[MAX_PATH], tmp_path[MAX_PATH];
+    LARGE_INTEGER frequency;
+    void *data = NULL;
+    DWORD written;
+    size_t size;
+    HANDLE file;
+    BOOL ret;
+
+    if (!device_vk->vk_pipeline_cache)
+        return;
+
+    QueryPerformanceFrequency(&frequency);
+    TRACE_(d3d_perf)("Created %u graphics pipelines in %.3f ms.\n", device_vk->pipeline_count,
+            1000.0 * device_vk->pipeline_time / frequency.QuadPart);
+
+    if (wined3d_settings.shader_cache_path
+            && VK_CALL(vkGetPipelineCacheData(device_vk->vk_device, device_vk->vk_pipeline_cache, &size, NULL)) >= 0
+            && size && (data = heap_alloc(size))
+            && VK_CALL(vkGetPipelineCacheData(device_vk->vk_device, device_vk->vk_pipeline_cache, &size, data)) >= 0)
+    {
+        wined3d_device_vk_get_pipeline_cache_path(path, sizeof(path));
+        snprintf(tmp_path, sizeof(tmp_path), "%s.%x", path, GetCurrentProcessId());
+        if ((file = CreateFileA(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) != INVALID_HANDLE_VALUE)
+        {
+            ret = WriteFile(file, data, size, &written, NULL) && written == size;
+            CloseHandle(file);
+            if (!ret || !MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+            {
+                WARN("Failed to write %s.\n", debugstr_a(path));
+                DeleteFileA(tmp_path);
+            }
+        }
+    }
+    heap_free(data);
+
+    VK_CALL(vkDestroyPipelineCache(device_vk->vk_device, device_vk->vk_pipeline_cache, NULL));
+    device_vk->vk_pipeline_cache = VK_NULL_HANDLE;
+}
+
 static HRESULT adapter_vk_create_device(struct wined3d *wined3d, const struct wined3d_adapter *adapter,
         enum wined3d_device_type device_type, HWND focus_window, unsigned int flags, BYTE surface_alignment,
         const enum wined3d_feature_level *levels, unsigned int level_count,
@@ -513,10 +611,13 @@ static HRESULT adapter_vk_create_device(struct wined3d *wined3d, const struct wi
         goto fail;
     }
 
+    wined3d_device_vk_create_pipeline_cache(device_vk);
+
     if (FAILED(hr = wined3d_device_init(&device_vk->d, wined3d, adapter->ordinal, device_type, focus_window,
             flags, surface_alignment, levels, level_count, vk_info->supported, device_parent)))
     {
         WARN("Failed to initialize device, hr %#x.\n", hr);
+        wined3d_device_vk_destroy_pipeline_cache(device_vk);
         wined3d_allocator_cleanup(&device_vk->allocator);
         goto fail;
     }
@@ -541,6 +642,7 @@ static void adapter_vk_destroy_device(struct wined3d_device *device)
     const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
 
     wined3d_device_cleanup(&device_vk->d);
+    wined3d_device_vk_destroy_pipeline_cache(device_vk);
     wined3d_allocator_cleanup(&device_vk->allocator);
 
     if (device_vk->allocator_cs.DebugInfo != (RTL_CRITICAL_SECTION_DEBUG *)-1)
@@ -3074,6 +3074,7 @@ static VkPipeline wined3d_context_vk_get_graphics_pipeline(struct wined3d_contex
     struct wined3d_graphics_pipeline_vk *pipeline_vk;
     struct wined3d_graphics_pipeline_key_vk *key;
     struct wine_rb_entry *entry;
+    LARGE_INTEGER start, end;
     VkResult vr;
 
     key = &context_vk->graphics.pipeline_key_vk;
@@ -3084,8 +3085,14 @@ static VkPipeline wined3d_context_vk_get_graphics_pipeline(struct wined3d_contex
         return VK_NULL_HANDLE;
     pipeline_vk->key = *key;
 
-    if ((vr = VK_CALL(vkCreateGraphicsPipelines(device_vk->vk_device,
-            VK_NULL_HANDLE, 1, &key->pipeline_desc, NULL, &pipeline_vk->vk_pipeline))) < 0)
+    QueryPerformanceCounter(&start);
+    vr = VK_CALL(vkCreateGraphicsPipelines(device_vk->vk_device,
+            device_vk->vk_pipeline_cache, 1, &key->pipeline_desc, NULL, &pipeline_vk->vk_pipeline));
+    QueryPerformanceCounter(&end);
+    ++device_vk->pipeline_count;
+    device_vk->pipeline_time += end.QuadPart - start.QuadPart;
+
+    if (vr < 0)
     {
         WARN("Failed to create graphics pipeline, vr %s.\n", wined3d_debug_vkresult(vr));
         heap_free(pipeline_vk);
@@ -20,6 +20,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(d3d_sync);
 WINE_DECLARE_DEBUG_CHANNEL(fps);
 
@@ -46,7 +47,7 @@ struct wined3d_command_list
 
     struct wined3d_device *device;
 
-    SIZE_T data_size;
+    SIZE_T data_size, data_capacity;
     void *data;
 
     SIZE_T resource_count;
@@ -80,6 +81,45 @@ struct wined3d_command_list
     struct wined3d_sampler **samplers;
 };
 
+static void wined3d_cs_put_command_buffer(struct wined3d_cs *cs, void *data, SIZE_T capacity)
+{
+    if (!data)
+        return;
+
+    if (capacity > WINED3D_CS_COMMAND_BUFFER_MAX_POOLED_SIZE)
+    {
+        heap_free(data);
+        return;
+    }
+
+    EnterCriticalSection(&cs->command_buffer_cs);
+    if (cs->command_buffer_count < ARRAY_SIZE(cs->command_buffers))
+    {
+        cs->command_buffers[cs->command_buffer_count].data = data;
+        cs->command_buffers[cs->command_buffer_count].capacity = capacity;
+        ++cs->command_buffer_count;
+        data = NULL;
+    }
+    LeaveCriticalSection(&cs->command_buffer_cs);
+
+    heap_free(data);
+}
+
+static void wined3d_cs_get_command_buffer(struct wined3d_cs *cs, void **data, SIZE_T *capacity)
+{
+    *data = NULL;
+    *capacity = 0;
+
+    EnterCriticalSection(&cs->command_buffer_cs);
+    if (cs->command_buffer_count)
+    {
+        --cs->command_buffer_count;
+        *data = cs->command_buffers[cs->command_buffer_count].data;
+        *capacity = cs->command_buffers[cs->command_buffer_count].capacity;
+    }
+    LeaveCriticalSection(&cs->command_buffer_cs);
+}
+
 static void wined3d_command_list_destroy_object(void *object)
 {
     struct wined3d_command_list *list = object;
@@ -90,6 +130,7 @@ static void wined3d_command_list_destroy_object(void *object)
     for (i = 0; i < list->upload_count; ++i)
         heap_free(list->uploads[i].sysmem);
 
+    wined3d_cs_put_command_buffer(list->device->cs, list->data, list->data_capacity);
     heap_free(list);
 }
 
@@ -201,6 +242,31 @@ enum wined3d_cs_op
     WINED3D_CS_OP_STOP,
 };
 
+#define WINED3D_CS_OCCUPANCY_BUCKETS 8
+
+/* Sub-resource updates up to this size are copied into the command stream
+ * instead of waiting for the CS thread to read the application's data. */
+#define WINED3D_CS_UPDATE_SUB_RESOURCE_COPY_SIZE (WINED3D_CS_QUEUE_SIZE / 16)
+
+/* Collected when d3d_perf tracing is enabled. The producer and CS thread
+ * counters are updated without synchronisation, so reports are approximate. */
+struct wined3d_cs_stats
+{
+    LONGLONG frequency;
+    LONGLONG prev_report;
+
+    /* CS thread. */
+    unsigned int op_count[WINED3D_CS_OP_STOP];
+    LONGLONG op_time[WINED3D_CS_OP_STOP];
+    LONGLONG idle_time;
+
+    /* Producer thread. */
+    unsigned int occupancy[WINED3D_CS_OCCUPANCY_BUCKETS];
+    unsigned int stall_count, finish_count;
+    LONGLONG stall_time, finish_time;
+    UINT64 upload_bytes[3]; /* mapped, copied, synchronous */
+};
+
 struct wined3d_cs_packet
 {
     size_t size;
@@ -2842,18 +2908,33 @@ void wined3d_device_context_emit_update_sub_resource(struct wined3d_device_conte
         struct wined3d_resource *resource, unsigned int sub_resource_idx, const struct wined3d_box *box,
         const void *data, unsigned int row_pitch, unsigned int slice_pitch)
 {
+    struct wined3d_cs_stats *stats = NULL;
+    unsigned int packed_row_pitch, packed_slice_pitch;
     struct wined3d_cs_update_sub_resource *op;
+    unsigned int width, height, depth;
     struct wined3d_map_desc map_desc;
     struct wined3d_box dummy_box;
     struct upload_bo bo;
+    size_t size;
 
     /* If we are replacing the whole resource, the CS thread might discard and
      * rename the buffer object, in which case ours is no longer valid. */
     if (resource->type == WINED3D_RTYPE_BUFFER && box->right - box->left == resource->size)
         invalidate_client_address(resource);
 
+    if (context == &context->device->cs->c)
+        stats = context->device->cs->stats;
+
+    width = box->right - box->left;
+    height = box->bottom - box->top;
+    depth = box->back - box->front;
+    wined3d_format_calculate_pitch(resource->format, 1, width, height, &packed_row_pitch, &packed_slice_pitch);
+    size = (size_t)packed_slice_pitch * depth;
+
     if (context->ops->map_upload_bo(context, resource, sub_resource_idx, &map_desc, box, WINED3D_MAP_WRITE))
     {
+        if (stats)
+            stats->upload_bytes[0] += size;
         wined3d_format_copy_data(resource->format, data, row_pitch, slice_pitch, map_desc.data, map_desc.row_pitch,
                 map_desc.slice_pitch, box->right - box->left, box->bottom - box->top, box->back - box->front);
         context->ops->unmap_upload_bo(context, resource, sub_resource_idx, &dummy_box, &bo);
@@ -2862,8 +2943,41 @@ void wined3d_device_context_emit_update_sub_resource(struct wined3d_device_conte
         return;
     }
 
+    /* Only for the immediate context: deferred contexts can't use the map
+     * queue, and their recording buffer may be reallocated, which would leave
+     * the data address dangling. The update goes in the default queue, so
+     * that it's executed in order with the draws and copies around it. */
+    if (context == &context->device->cs->c && size <= WINED3D_CS_UPDATE_SUB_RESOURCE_COPY_SIZE)
+    {
+        op = wined3d_device_context_require_space(context, sizeof(*op) + size, WINED3D_CS_QUEUE_DEFAULT);
+        op->opcode = WINED3D_CS_OP_UPDATE_SUB_RESOURCE;
+        op->resource = resource;
+        op->sub_resource_idx = sub_resource_idx;
+        op->box = *box;
+        op->bo.addr.buffer_object = 0;
+        op->bo.addr.addr = (BYTE *)(op + 1);
+        op->bo.flags = 0;
+        op->row_pitch = packed_row_pitch;
+        op->slice_pitch = packed_slice_pitch;
+
+        wined3d_format_copy_data(resource->format, data, row_pitch, slice_pitch,
+                (BYTE *)(op + 1), packed_row_pitch, packed_slice_pitch, width, height, depth);
+
+        wined3d_device_context_acquire_resource(context, resource);
+
+        /* The data lives in the command stream until the update is executed,
+         * so there is no need to wait for it or for the resource. */
+        wined3d_device_context_submit(context, WINED3D_CS_QUEUE_DEFAULT);
+        if (stats)
+            stats->upload_bytes[1] += size;
+        return;
+    }
+
     wined3d_resource_wait_idle(resource);
 
+    if (stats)
+        stats->upload_bytes[2] += size;
+
     op = wined3d_device_context_require_space(context, sizeof(*op), WINED3D_CS_QUEUE_MAP);
     op->opcode = WINED3D_CS_OP_UPDATE_SUB_RESOURCE;
     op->resource = resource;
@@ -3291,6 +3405,64 @@ static const struct wined3d_device_context_ops wined3d_cs_st_ops =
     wined3d_cs_acquire_samplers,
 };
 
+static LONGLONG wined3d_cs_perf_counter(void)
+{
+    LARGE_INTEGER counter;
+
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+static double wined3d_cs_perf_ms(const struct wined3d_cs_stats *stats, LONGLONG time)
+{
+    return 1000.0 * time / stats->frequency;
+}
+
+static void wined3d_cs_report_stats(struct wined3d_cs *cs, LONGLONG now)
+{
+    struct wined3d_cs_stats *stats = cs->stats;
+    unsigned int i, total = 0;
+    LONGLONG elapsed;
+
+    if (!(elapsed = now - stats->prev_report))
+        return;
+
+    TRACE_(d3d_perf)("cs %p: %.2f ms elapsed, %.2f ms idle.\n", cs,
+            wined3d_cs_perf_ms(stats, elapsed), wined3d_cs_perf_ms(stats, stats->idle_time));
+    for (i = 0; i < ARRAY_SIZE(stats->op_count); ++i)
+    {
+        if (!stats->op_count[i])
+            continue;
+        TRACE_(d3d_perf)("  %-44s %8u ops, %9.3f ms, %8.2f us/op.\n", debug_cs_op(i), stats->op_count[i],
+                wined3d_cs_perf_ms(stats, stats->op_time[i]),
+                1000.0 * wined3d_cs_perf_ms(stats, stats->op_time[i]) / stats->op_count[i]);
+        total += stats->op_count[i];
+    }
+    TRACE_(d3d_perf)("  %u ops total.\n", total);
+
+    TRACE_(d3d_perf)("  producer: %u queue full stalls, %.3f ms; %u finish waits, %.3f ms.\n",
+            stats->stall_count, wined3d_cs_perf_ms(stats, stats->stall_time),
+            stats->finish_count, wined3d_cs_perf_ms(stats, stats->finish_time));
+    TRACE_(d3d_perf)("  sub-resource updates: %s bytes mapped, %s bytes copied, %s bytes synchronous.\n",
+            wine_dbgstr_longlong(stats->upload_bytes[0]), wine_dbgstr_longlong(stats->upload_bytes[1]),
+            wine_dbgstr_longlong(stats->upload_bytes[2]));
+    for (i = 0; i < ARRAY_SIZE(stats->occupancy); ++i)
+    {
+        TRACE_(d3d_perf)("  queue occupancy %3u%%-%3u%%: %u submits.\n",
+                100 * i / WINED3D_CS_OCCUPANCY_BUCKETS, 100 * (i + 1) / WINED3D_CS_OCCUPANCY_BUCKETS,
+                stats->occupancy[i]);
+    }
+
+    memset(stats->op_count, 0, sizeof(stats->op_count));
+    memset(stats->op_time, 0, sizeof(stats->op_time));
+    memset(stats->occupancy, 0, sizeof(stats->occupancy));
+    stats->idle_time = 0;
+    stats->stall_count = stats->finish_count = 0;
+    stats->stall_time = stats->finish_time = 0;
+    memset(stats->upload_bytes, 0, sizeof(stats->upload_bytes));
+    stats->prev_report = now;
+}
+
 static BOOL wined3d_cs_queue_is_empty(const struct wined3d_cs *cs, const struct wined3d_cs_queue *queue)
 {
     wined3d_from_cs(cs);
@@ -3306,6 +3478,12 @@ static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
     InterlockedExchange(&queue->head, (queue->head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1));
 
+    if (cs->stats)
+    {
+        size_t used = (queue->head - *(volatile LONG *)&queue->tail) & (WINED3D_CS_QUEUE_SIZE - 1);
+        ++cs->stats->occupancy[used * WINED3D_CS_OCCUPANCY_BUCKETS / WINED3D_CS_QUEUE_SIZE];
+    }
+
     if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         SetEvent(cs->event);
 }
@@ -3325,6 +3503,7 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
     size_t queue_size = ARRAY_SIZE(queue->data);
     size_t header_size, packet_size, remaining;
     struct wined3d_cs_packet *packet;
+    LONGLONG stall_start = 0;
 
     header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
@@ -3375,6 +3554,14 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
 
         TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
                 head, tail, (unsigned long)packet_size);
+        if (cs->stats && !stall_start)
+            stall_start = wined3d_cs_perf_counter();
+    }
+
+    if (stall_start)
+    {
+        ++cs->stats->stall_count;
+        cs->stats->stall_time += wined3d_cs_perf_counter() - stall_start;
     }
 
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
@@ -3396,12 +3583,22 @@ static void *wined3d_cs_mt_require_space(struct wined3d_device_context *context,
 static void wined3d_cs_mt_finish(struct wined3d_device_context *context, enum wined3d_cs_queue_id queue_id)
 {
     struct wined3d_cs *cs = wined3d_cs_from_context(context);
+    LONGLONG start = 0;
 
     if (cs->thread_id == GetCurrentThreadId())
         return wined3d_cs_st_finish(context, queue_id);
 
+    if (cs->stats && cs->queue[queue_id].head != *(volatile LONG *)&cs->queue[queue_id].tail)
+        start = wined3d_cs_perf_counter();
+
     while (cs->queue[queue_id].head != *(volatile LONG *)&cs->queue[queue_id].tail)
         YieldProcessor();
+
+    if (start)
+    {
+        ++cs->stats->finish_count;
+        cs->stats->finish_time += wined3d_cs_perf_counter() - start;
+    }
 }
 
 static const struct wined3d_device_context_ops wined3d_cs_mt_ops =
@@ -3475,6 +3672,7 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
     struct wined3d_cs_queue *queue;
     unsigned int spin_count = 0;
     struct wined3d_cs *cs = ctx;
+    LONGLONG start, now, idle_start = 0;
     enum wined3d_cs_op opcode;
     HMODULE wined3d_module;
     unsigned int poll = 0;
@@ -3504,6 +3702,8 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             queue = &cs->queue[WINED3D_CS_QUEUE_DEFAULT];
             if (wined3d_cs_queue_is_empty(cs, queue))
             {
+                if (cs->stats && !idle_start)
+                    idle_start = wined3d_cs_perf_counter();
                 if (++spin_count >= WINED3D_CS_SPIN_COUNT && list_empty(&cs->query_poll_list))
                     wined3d_cs_wait_event(cs);
                 continue;
@@ -3511,6 +3711,12 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
         }
         spin_count = 0;
 
+        if (idle_start)
+        {
+            cs->stats->idle_time += wined3d_cs_perf_counter() - idle_start;
+            idle_start = 0;
+        }
+
         tail = queue->tail;
         packet = (struct wined3d_cs_packet *)&queue->data[tail];
         if (packet->size)
@@ -3525,9 +3731,25 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
                 break;
             }
 
-            wined3d_cs_command_lock(cs);
-            wined3d_cs_op_handlers[opcode](cs, packet->data);
-            wined3d_cs_command_unlock(cs);
+            if (cs->stats)
+            {
+                start = wined3d_cs_perf_counter();
+                wined3d_cs_command_lock(cs);
+                wined3d_cs_op_handlers[opcode](cs, packet->data);
+                wined3d_cs_command_unlock(cs);
+                now = wined3d_cs_perf_counter();
+                ++cs->stats->op_count[opcode];
+                cs->stats->op_time[opcode] += now - start;
+                /* every second */
+                if (now - cs->stats->prev_report > cs->stats->frequency)
+                    wined3d_cs_report_stats(cs, now);
+            }
+            else
+            {
+                wined3d_cs_command_lock(cs);
+                wined3d_cs_op_handlers[opcode](cs, packet->data);
+                wined3d_cs_command_unlock(cs);
+            }
             TRACE("%s executed.\n", debug_cs_op(opcode));
         }
 
@@ -3559,6 +3781,10 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
 
     cs->c.ops = &wined3d_cs_st_ops;
     cs->c.device = device;
+
+    InitializeCriticalSection(&cs->command_buffer_cs);
+    if (cs->command_buffer_cs.DebugInfo != (RTL_CRITICAL_SECTION_DEBUG *)-1)
+        cs->command_buffer_cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": wined3d_cs.command_buffer_cs");
     cs->serialize_commands = TRACE_ON(d3d_sync) || wined3d_settings.cs_multithreaded & WINED3D_CSMT_SERIALIZE;
 
     if (cs->serialize_commands)
@@ -3575,10 +3801,20 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
     {
         cs->c.ops = &wined3d_cs_mt_ops;
 
+        if (TRACE_ON(d3d_perf) && (cs->stats = heap_alloc_zero(sizeof(*cs->stats))))
+        {
+            LARGE_INTEGER frequency;
+
+            QueryPerformanceFrequency(&frequency);
+            cs->stats->frequency = frequency.QuadPart;
+            cs->stats->prev_report = wined3d_cs_perf_counter();
+        }
+
         if (!(cs->event = CreateEventW(NULL, FALSE, FALSE, NULL)))
         {
             ERR("Failed to create command stream event.\n");
             heap_free(cs->data);
+            heap_free(cs->stats);
             goto fail;
         }
 
@@ -3588,6 +3824,7 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
             ERR("Failed to get wined3d module handle.\n");
             CloseHandle(cs->event);
             heap_free(cs->data);
+            heap_free(cs->stats);
             goto fail;
         }
 
@@ -3597,6 +3834,7 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
             FreeLibrary(cs->wined3d_module);
             CloseHandle(cs->event);
             heap_free(cs->data);
+            heap_free(cs->stats);
             goto fail;
         }
     }
@@ -3604,6 +3842,9 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
     return cs;
 
 fail:
+    if (cs->command_buffer_cs.DebugInfo != (RTL_CRITICAL_SECTION_DEBUG *)-1)
+        cs->command_buffer_cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection(&cs->command_buffer_cs);
     wined3d_state_destroy(cs->c.state);
     state_cleanup(&cs->state);
     heap_free(cs);
@@ -3620,6 +3861,18 @@ void wined3d_cs_destroy(struct wined3d_cs *cs)
             ERR("Closing event failed.\n");
     }
 
+    if (cs->stats)
+    {
+        wined3d_cs_report_stats(cs, wined3d_cs_perf_counter());
+        heap_free(cs->stats);
+    }
+
+    while (cs->command_buffer_count)
+        heap_free(cs->command_buffers[--cs->command_buffer_count].data);
+    if (cs->command_buffer_cs.DebugInfo != (RTL_CRITICAL_SECTION_DEBUG *)-1)
+        cs->command_buffer_cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection(&cs->command_buffer_cs);
+
     wined3d_state_destroy(cs->c.state);
     state_cleanup(&cs->state);
     heap_free(cs->data);
@@ -4045,8 +4298,7 @@ HRESULT CDECL wined3d_deferred_context_record_command_list(struct wined3d_device
             + deferred->rasterizer_state_count * sizeof(*object->rasterizer_states)
             + deferred->depth_stencil_state_count * sizeof(*object->depth_stencil_states)
             + deferred->shader_count * sizeof(*object->shaders)
-            + deferred->sampler_count * sizeof(*object->samplers)
-            + deferred->data_size);
+            + deferred->sampler_count * sizeof(*object->samplers));
 
     if (!memory)
     {
@@ -4117,9 +4369,13 @@ HRESULT CDECL wined3d_deferred_context_record_command_list(struct wined3d_device
     memcpy(object->samplers, deferred->samplers, deferred->sampler_count * sizeof(*object->samplers));
     /* Transfer our references to the samplers to the command list. */
 
-    object->data = memory;
+    /* Hand the recorded commands over to the command list instead of copying
+     * them, and continue recording into a buffer recycled from a previously
+     * destroyed command list. */
+    object->data = deferred->data;
     object->data_size = deferred->data_size;
-    memcpy(object->data, deferred->data, deferred->data_size);
+    object->data_capacity = deferred->data_capacity;
+    wined3d_cs_get_command_buffer(deferred->c.device->cs, &deferred->data, &deferred->data_capacity);
 
     deferred->data_size = 0;
     deferred->resource_count = 0;
@@ -21,6 +21,7 @@
 
 #include "wined3d_private.h"
 
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(winediag);
 
 #ifdef SONAME_LIBVKD3D_SHADER
@@ -64,6 +65,29 @@ struct shader_spirv_priv
     bool ffp_proj_control;
 
     struct shader_spirv_resource_bindings bindings;
+
+    unsigned int cache_hits, cache_misses;
+};
+
+#define SHADER_SPIRV_CACHE_MAGIC 0x32505357 /* "WSP2" */
+
+struct shader_spirv_cache_key
+{
+    uint64_t hash[2];
+    /* The complete key, stored in the entry and compared on load. */
+    uint8_t *data;
+    SIZE_T size, capacity;
+    bool valid;
+};
+
+/* Followed by the key data and the SPIR-V code. */
+struct shader_spirv_cache_header
+{
+    uint32_t magic;
+    uint32_t key_size;
+    uint32_t code_size;
+    uint32_t padding;
+    uint64_t hash[2];
 };
 
 struct shader_spirv_compile_arguments
@@ -277,6 +301,167 @@ static const char *get_line(const char **ptr)
     return p;
 }
 
+static void shader_spirv_cache_key_update(struct shader_spirv_cache_key *key, const void *data, size_t size)
+{
+    const uint8_t *p = data;
+
+    if (!size)
+        return;
+
+    if (key->valid && wined3d_array_reserve((void **)&key->data, &key->capacity, key->size + size, 1))
+    {
+        memcpy(key->data + key->size, data, size);
+        key->size += size;
+    }
+    else
+    {
+        key->valid = false;
+    }
+
+    while (size--)
+    {
+        key->hash[0] = (key->hash[0] ^ *p) * 0x100000001b3ull;
+        key->hash[1] = (key->hash[1] + *p++) * 0x9e3779b97f4a7c15ull;
+        key->hash[1] ^= key->hash[1] >> 29;
+    }
+}
+
+static void shader_spirv_cache_key_init(struct shader_spirv_cache_key *key,
+        const struct wined3d_shader_desc *shader_desc, enum wined3d_shader_type shader_type,
+        const struct shader_spirv_compile_arguments *args, const struct shader_spirv_resource_bindings *bindings,
+        const struct wined3d_stream_output_desc *so_desc)
+{
+    const char *version = vkd3d_shader_get_version(NULL, NULL);
+    uint32_t size = shader_desc->byte_code_size;
+    uint8_t has_args = !!args;
+    unsigned int i;
+
+    key->hash[0] = 0xcbf29ce484222325ull;
+    key->hash[1] = 0x84222325cbf29ce4ull;
+    key->data = NULL;
+    key->size = key->capacity = 0;
+    key->valid = true;
+
+    /* Output of different vkd3d-shader versions may differ. */
+    shader_spirv_cache_key_update(key, version, strlen(version) + 1);
+    shader_spirv_cache_key_update(key, &shader_type, sizeof(shader_type));
+    shader_spirv_cache_key_update(key, &size, sizeof(size));
+    shader_spirv_cache_key_update(key, shader_desc->byte_code, shader_desc->byte_code_size);
+    /* Compute shaders have no compile arguments. */
+    shader_spirv_cache_key_update(key, &has_args, sizeof(has_args));
+    if (args)
+        shader_spirv_cache_key_update(key, args, sizeof(*args));
+    shader_spirv_cache_key_update(key, bindings->bindings, bindings->binding_count * sizeof(*bindings->bindings));
+    shader_spirv_cache_key_update(key, bindings->uav_counters,
+            bindings->uav_counter_count * sizeof(*bindings->uav_counters));
+
+    if (!so_desc)
+        return;
+
+    for (i = 0; i < so_desc->element_count; ++i)
+    {
+        const struct wined3d_stream_output_element *e = &so_desc->elements[i];
+
+        shader_spirv_cache_key_update(key, &e->stream_idx, sizeof(e->stream_idx));
+        if (e->semantic_name)
+            shader_spirv_cache_key_update(key, e->semantic_name, strlen(e->semantic_name) + 1);
+        shader_spirv_cache_key_update(key, &e->semantic_idx, sizeof(e->semantic_idx));
+        shader_spirv_cache_key_update(key, &e->component_idx, sizeof(e->component_idx));
+        shader_spirv_cache_key_update(key, &e->component_count, sizeof(e->component_count));
+        shader_spirv_cache_key_update(key, &e->output_slot, sizeof(e->output_slot));
+    }
+    shader_spirv_cache_key_update(key, so_desc->buffer_strides,
+            so_desc->buffer_stride_count * sizeof(*so_desc->buffer_strides));
+}
+
+static void shader_spirv_cache_key_cleanup(struct shader_spirv_cache_key *key)
+{
+    heap_free(key->data);
+}
+
+static void shader_spirv_cache_get_path(char *path, size_t size, const struct shader_spirv_cache_key *key)
+{
+    snprintf(path, size, "%s\\%08x%08x%08x%08x.spv", wined3d_settings.shader_cache_path,
+            (unsigned int)(key->hash[0] >> 32), (unsigned int)key->hash[0],
+            (unsigned int)(key->hash[1] >> 32), (unsigned int)key->hash[1]);
+}
+
+static void *shader_spirv_cache_load(const struct shader_spirv_cache_key *key, size_t *size)
+{
+    struct shader_spirv_cache_header header;
+    uint8_t *key_data = NULL;
+    char path[MAX_PATH];
+    void *code = NULL;
+    DWORD read;
+    HANDLE file;
+
+    if (!key->valid)
+        return NULL;
+
+    shader_spirv_cache_get_path(path, sizeof(path), key);
+    if ((file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    /* The file name only identifies the hash; only trust entries whose full key matches. */
+    if (ReadFile(file, &header, sizeof(header), &read, NULL) && read == sizeof(header)
+            && header.magic == SHADER_SPIRV_CACHE_MAGIC && !memcmp(header.hash, key->hash, sizeof(key->hash))
+            && header.key_size == key->size && (key_data = heap_alloc(header.key_size))
+            && ReadFile(file, key_data, header.key_size, &read, NULL) && read == header.key_size
+            && !memcmp(key_data, key->data, key->size)
+            && header.code_size && !(header.code_size & 3) && (code = heap_alloc(header.code_size)))
+    {
+        if (!ReadFile(file, code, header.code_size, &read, NULL) || read != header.code_size)
+        {
+            WARN("Failed to read %s.\n", debugstr_a(path));
+            heap_free(code);
+            code = NULL;
+        }
+        *size = header.code_size;
+    }
+
+    heap_free(key_data);
+    CloseHandle(file);
+    return code;
+}
+
+static void shader_spirv_cache_store(const struct shader_spirv_cache_key *key, const void *code, size_t size)
+{
+    struct shader_spirv_cache_header header;
+    char path[MAX_PATH], tmp_path[MAX_PATH];
+    DWORD written;
+    HANDLE file;
+    BOOL ret;
+
+    if (!key->valid)
+        return;
+
+    shader_spirv_cache_get_path(path, sizeof(path), key);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%x", path, GetCurrentProcessId());
+    if ((file = CreateFileA(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create %s, error %u.\n", debugstr_a(tmp_path), GetLastError());
+        return;
+    }
+
+    header.magic = SHADER_SPIRV_CACHE_MAGIC;
+    header.key_size = key->size;
+    header.code_size = size;
+    header.padding = 0;
+    memcpy(header.hash, key->hash, sizeof(header.hash));
+    ret = WriteFile(file, &header, sizeof(header), &written, NULL) && written == sizeof(header)
+            && WriteFile(file, key->data, key->size, &written, NULL) && written == key->size
+            && WriteFile(file, code, size, &written, NULL) && written == size;
+    CloseHandle(file);
+
+    /* Other processes only ever see complete files. */
+    if (!ret || !MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to write %s.\n", debugstr_a(path));
+        DeleteFileA(tmp_path);
+    }
+}
+
 static void shader_spirv_init_shader_interface_vk(struct wined3d_shader_spirv_shader_interface *iface,
         const struct shader_spirv_resource_bindings *b, const struct wined3d_stream_output_desc *so_desc)
 {
@@ -308,7 +493,9 @@ static VkShaderModule shader_spirv_compile_shader(struct wined3d_context_vk *con
         const struct shader_spirv_compile_arguments *args, const struct shader_spirv_resource_bindings *bindings,
         const struct wined3d_stream_output_desc *so_desc)
 {
+    struct shader_spirv_priv *priv = context_vk->c.device->shader_priv;
     struct wined3d_shader_spirv_compile_args compile_args;
+    struct shader_spirv_cache_key cache_key;
     struct wined3d_shader_spirv_shader_interface iface;
     VkShaderModuleCreateInfo shader_create_info;
     struct vkd3d_shader_compile_info info;
@@ -316,10 +503,24 @@ static VkShaderModule shader_spirv_compile_shader(struct wined3d_context_vk *con
     struct wined3d_device_vk *device_vk;
     struct vkd3d_shader_code spirv;
     VkShaderModule module;
+    void *cached_code;
     char *messages;
     VkResult vr;
     int ret;
 
+    if (wined3d_settings.shader_cache_path)
+    {
+        shader_spirv_cache_key_init(&cache_key, shader_desc, shader_type, args, bindings, so_desc);
+        if ((cached_code = shader_spirv_cache_load(&cache_key, &spirv.size)))
+        {
+            ++priv->cache_hits;
+            spirv.code = cached_code;
+            shader_spirv_cache_key_cleanup(&cache_key);
+            goto create_module;
+        }
+        ++priv->cache_misses;
+    }
+
     shader_spirv_init_shader_interface_vk(&iface, bindings, so_desc);
     shader_spirv_init_compile_args(&compile_args, &iface.vkd3d_interface,
             VKD3D_SHADER_SPIRV_ENVIRONMENT_VULKAN_1_0, shader_type, args);
@@ -353,9 +554,19 @@ static VkShaderModule shader_spirv_compile_shader(struct wined3d_context_vk *con
     if (ret < 0)
     {
         ERR("Failed to compile DXBC, ret %d.\n", ret);
+        if (wined3d_settings.shader_cache_path)
+            shader_spirv_cache_key_cleanup(&cache_key);
         return VK_NULL_HANDLE;
     }
 
+    if (wined3d_settings.shader_cache_path)
+    {
+        shader_spirv_cache_store(&cache_key, spirv.code, spirv.size);
+        shader_spirv_cache_key_cleanup(&cache_key);
+    }
+    cached_code = NULL;
+
+create_module:
     device_vk = wined3d_device_vk(context_vk->c.device);
     vk_info = &device_vk->vk_info;
 
@@ -364,15 +575,19 @@ static VkShaderModule shader_spirv_compile_shader(struct wined3d_context_vk *con
     shader_create_info.flags = 0;
     shader_create_info.codeSize = spirv.size;
     shader_create_info.pCode = spirv.code;
-    if ((vr = VK_CALL(vkCreateShaderModule(device_vk->vk_device, &shader_create_info, NULL, &module))) < 0)
-    {
+    vr = VK_CALL(vkCreateShaderModule(device_vk->vk_device, &shader_create_info, NULL, &module));
+
+    if (cached_code)
+        heap_free(cached_code);
+    else
         vkd3d_shader_free_shader_code(&spirv);
+
+    if (vr < 0)
+    {
         WARN("Failed to create Vulkan shader module, vr %s.\n", wined3d_debug_vkresult(vr));
         return VK_NULL_HANDLE;
     }
 
-    vkd3d_shader_free_shader_code(&spirv);
-
     return module;
 }
 
@@ -473,7 +688,7 @@ static struct shader_spirv_compute_program_vk *shader_spirv_find_compute_program
     pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
     pipeline_info.basePipelineIndex = -1;
     if ((vr = VK_CALL(vkCreateComputePipelines(device_vk->vk_device,
-            VK_NULL_HANDLE, 1, &pipeline_info, NULL, &program->vk_pipeline))) < 0)
+            device_vk->vk_pipeline_cache, 1, &pipeline_info, NULL, &program->vk_pipeline))) < 0)
     {
         ERR("Failed to create Vulkan compute pipeline, vr %s.\n", wined3d_debug_vkresult(vr));
         VK_CALL(vkDestroyShaderModule(device_vk->vk_device, program->vk_module, NULL));
@@ -1065,6 +1280,7 @@ static HRESULT shader_spirv_alloc(struct wined3d_device *device,
     fragment_pipe->get_caps(device->adapter, &fragment_caps);
     priv->ffp_proj_control = fragment_caps.wined3d_caps & WINED3D_FRAGMENT_CAP_PROJ_CONTROL;
     memset(&priv->bindings, 0, sizeof(priv->bindings));
+    priv->cache_hits = priv->cache_misses = 0;
 
     device->vertex_priv = vertex_priv;
     device->fragment_priv = fragment_priv;
@@ -1077,6 +1293,9 @@ static void shader_spirv_free(struct wined3d_device *device, struct wined3d_cont
 {
     struct shader_spirv_priv *priv = device->shader_priv;
 
+    if (wined3d_settings.shader_cache_path)
+        TRACE_(d3d_perf)("Shader cache: %u hits, %u misses.\n", priv->cache_hits, priv->cache_misses);
+
     shader_spirv_resource_bindings_cleanup(&priv->bindings);
     priv->fragment_pipe->free_private(device, context);
     priv->vertex_pipe->vp_free(device, context);
@@ -497,6 +497,7 @@ struct wined3d_settings
     enum wined3d_renderer renderer;
     enum wined3d_shader_backend shader_backend;
     BOOL cb_access_map_w;
+    char *shader_cache_path;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
@@ -4110,6 +4111,10 @@ struct wined3d_device_vk
     struct wined3d_allocator allocator;
 
     struct wined3d_uav_clear_state_vk uav_clear_state;
+
+    VkPipelineCache vk_pipeline_cache;
+    unsigned int pipeline_count;
+    LONGLONG pipeline_time;
 };
 
 static inline struct wined3d_device_vk *wined3d_device_vk(struct wined3d_device *device)
@@ -4865,6 +4870,16 @@ struct wined3d_device_context
     struct wined3d_state *state;
 };
 
+#define WINED3D_CS_COMMAND_BUFFER_POOL_SIZE 16
+/* Larger recording buffers are freed rather than kept for the lifetime of the device. */
+#define WINED3D_CS_COMMAND_BUFFER_MAX_POOLED_SIZE 0x100000u
+
+struct wined3d_cs_command_buffer
+{
+    void *data;
+    SIZE_T capacity;
+};
+
 struct wined3d_cs
 {
     struct wined3d_device_context c;
@@ -4884,6 +4899,13 @@ struct wined3d_cs
     HANDLE event;
     BOOL waiting_for_event;
     LONG pending_presents;
+
+    struct wined3d_cs_stats *stats;
+
+    /* Recording buffers of destroyed command lists, reused by deferred contexts. */
+    CRITICAL_SECTION command_buffer_cs;
+    SIZE_T command_buffer_count;
+    struct wined3d_cs_command_buffer command_buffers[WINED3D_CS_COMMAND_BUFFER_POOL_SIZE];
 };
 
 static inline void wined3d_device_context_lock(struct wined3d_device_context *context)
@@ -544,13 +544,32 @@ static inline void fd_poll_event( struct fd *fd, int event )
 
 #ifdef USE_EPOLL
 
+#define EPOLL_MAX_EVENTS 512  /* max events retrieved by a single epoll_wait call */
+
 static int epoll_fd = -1;
+static unsigned int epoll_ctl_calls;     /* epoll_ctl calls since last stats dump */
+static unsigned int epoll_wait_events;   /* events returned since last stats dump */
+static timeout_t epoll_stats_time;       /* time of last stats dump */
 
 static inline void init_epoll(void)
 {
     epoll_fd = epoll_create( 128 );
 }
 
+/* dump epoll statistics once per second when debugging is enabled */
+static void dump_epoll_stats(void)
+{
+    timeout_t elapsed = monotonic_time - epoll_stats_time;
+
+    if (elapsed < TICKS_PER_SEC) return;
+    if (epoll_ctl_calls || epoll_wait_events)
+        fprintf( stderr, "epoll: %u ctl calls/s, %u events/s, %d active users\n",
+                 (unsigned int)(epoll_ctl_calls * TICKS_PER_SEC / elapsed),
+                 (unsigned int)(epoll_wait_events * TICKS_PER_SEC / elapsed), active_users );
+    epoll_ctl_calls = epoll_wait_events = 0;
+    epoll_stats_time = monotonic_time;
+}
+
 /* set the events that epoll waits for on this fd; helper for set_fd_events */
 static inline void set_fd_epoll_events( struct fd *fd, int user, int events )
 {
@@ -578,6 +597,7 @@ static inline void set_fd_epoll_events( struct fd *fd, int user, int events )
     memset(&ev.data, 0, sizeof(ev.data));
     ev.data.u32 = user;
 
+    epoll_ctl_calls++;
     if (epoll_ctl( epoll_fd, ctl, fd->unix_fd, &ev ) == -1)
     {
         if (errno == ENOMEM)  /* not enough memory, give up on epoll */
@@ -596,6 +616,7 @@ static inline void remove_epoll_user( struct fd *fd, int user )
     if (pollfd[user].fd != -1)
     {
         struct epoll_event dummy;
+        epoll_ctl_calls++;
         epoll_ctl( epoll_fd, EPOLL_CTL_DEL, fd->unix_fd, &dummy );
     }
 }
@@ -603,7 +624,7 @@ static inline void remove_epoll_user( struct fd *fd, int user )
 static inline void main_loop_epoll(void)
 {
     int i, ret, timeout;
-    struct epoll_event events[128];
+    struct epoll_event events[EPOLL_MAX_EVENTS];
 
     assert( POLLIN == EPOLLIN );
     assert( POLLOUT == EPOLLOUT );
@@ -622,6 +643,12 @@ static inline void main_loop_epoll(void)
         ret = epoll_wait( epoll_fd, events, ARRAY_SIZE( events ), timeout );
         set_current_time();
 
+        if (debug_level > 1)
+        {
+            if (ret > 0) epoll_wait_events += ret;
+            dump_epoll_stats();
+        }
+
         /* put the events into the pollfd array first, like poll does */
         for (i = 0; i < ret; i++)
         {
@@ -36,6 +36,11 @@
 #include <utime.h>
 #endif
 #include <poll.h>
+#ifdef HAVE_LINUX_IO_URING_H
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -85,6 +90,7 @@ static struct list *file_get_kernel_obj_list( struct object *obj );
 static void file_destroy( struct object *obj );
 
 static enum server_fd_type file_get_fd_type( struct fd *fd );
+static void file_read( struct fd *fd, struct async *async, file_pos_t pos );
 
 static const struct object_ops file_ops =
 {
@@ -115,7 +121,7 @@ static const struct fd_ops file_fd_ops =
     default_fd_get_poll_events,   /* get_poll_events */
     default_poll_event,           /* poll_event */
     file_get_fd_type,             /* get_fd_type */
-    no_fd_read,                   /* read */
+    file_read,                    /* read */
     no_fd_write,                  /* write */
     no_fd_flush,                  /* flush */
     default_fd_get_file_info,     /* get_file_info */
@@ -306,6 +312,227 @@ static struct fd *file_get_fd( struct object *obj )
     return (struct fd *)grab_object( file->fd );
 }
 
+/* complete an overlapped read; result is the number of bytes read or a negative errno */
+static void file_read_complete( struct async *async, void *buffer, data_size_t size, int result )
+{
+    if (result < 0)
+    {
+        errno = -result;
+        file_set_error();
+        async_request_complete( async, get_error(), 0, 0, NULL );
+        clear_error();
+        free( buffer );
+        return;
+    }
+    if (!result)
+    {
+        free( buffer );
+        buffer = NULL;
+    }
+    async_request_complete( async, (result || !size) ? STATUS_SUCCESS : STATUS_END_OF_FILE,
+                            result, result, buffer );
+}
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+/* io_uring used to run overlapped reads of regular files in the kernel */
+
+#define URING_ENTRIES 256
+
+struct uring_read
+{
+    struct async *async;    /* async waiting for the read */
+    void         *buffer;   /* buffer the kernel reads into */
+    data_size_t   size;     /* size of the read */
+};
+
+static struct
+{
+    struct fd           *fd;         /* fd object for the ring, polled for completions */
+    unsigned int        *sq_tail;    /* submission queue */
+    unsigned int        *sq_mask;
+    unsigned int        *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned int        *cq_head;    /* completion queue */
+    unsigned int        *cq_tail;
+    unsigned int        *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned int         cq_entries;
+    unsigned int         pending;    /* reads submitted and not yet completed */
+    int                  failed;     /* io_uring is not available */
+} uring;
+
+static int uring_get_poll_events( struct fd *fd )
+{
+    return POLLIN;
+}
+
+/* reap the completed reads */
+static void uring_poll_event( struct fd *fd, int event )
+{
+    unsigned int head = *uring.cq_head;
+
+    while (head != __atomic_load_n( uring.cq_tail, __ATOMIC_ACQUIRE ))
+    {
+        struct io_uring_cqe *cqe = &uring.cqes[head & *uring.cq_mask];
+        struct uring_read *read = (struct uring_read *)(ULONG_PTR)cqe->user_data;
+        int result = cqe->res;
+
+        __atomic_store_n( uring.cq_head, ++head, __ATOMIC_RELEASE );
+        uring.pending--;
+
+        file_read_complete( read->async, read->buffer, read->size, result );
+        release_object( read->async );
+        free( read );
+    }
+}
+
+static const struct fd_ops uring_fd_ops =
+{
+    uring_get_poll_events,        /* get_poll_events */
+    uring_poll_event,             /* poll_event */
+    NULL,                         /* get_fd_type */
+    NULL,                         /* read */
+    NULL,                         /* write */
+    NULL,                         /* flush */
+    NULL,                         /* get_file_info */
+    NULL,                         /* get_volume_info */
+    NULL,                         /* ioctl */
+    NULL,                         /* cancel_async */
+    NULL,                         /* queue_async */
+    NULL                          /* reselect_async */
+};
+
+static int init_uring(void)
+{
+    struct io_uring_params params;
+    size_t sq_size, cq_size, sqes_size;
+    char *sq_ring, *cq_ring = MAP_FAILED;
+    void *sqes = MAP_FAILED;
+    int unix_fd;
+
+    if (uring.fd) return 1;
+    if (uring.failed) return 0;
+    uring.failed = 1;
+
+    memset( &params, 0, sizeof(params) );
+    if ((unix_fd = syscall( __NR_io_uring_setup, URING_ENTRIES, &params )) == -1) return 0;
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) sq_size = cq_size = max( sq_size, cq_size );
+
+    sq_ring = mmap( NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    unix_fd, IORING_OFF_SQ_RING );
+    if (sq_ring == MAP_FAILED) goto failed;
+    if (params.features & IORING_FEAT_SINGLE_MMAP) cq_ring = sq_ring;
+    else cq_ring = mmap( NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         unix_fd, IORING_OFF_CQ_RING );
+    if (cq_ring == MAP_FAILED) goto failed;
+    sqes = mmap( NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 unix_fd, IORING_OFF_SQES );
+    if (sqes == MAP_FAILED) goto failed;
+
+    uring.sq_tail    = (unsigned int *)(sq_ring + params.sq_off.tail);
+    uring.sq_mask    = (unsigned int *)(sq_ring + params.sq_off.ring_mask);
+    uring.sq_array   = (unsigned int *)(sq_ring + params.sq_off.array);
+    uring.sqes       = sqes;
+    uring.cq_head    = (unsigned int *)(cq_ring + params.cq_off.head);
+    uring.cq_tail    = (unsigned int *)(cq_ring + params.cq_off.tail);
+    uring.cq_mask    = (unsigned int *)(cq_ring + params.cq_off.ring_mask);
+    uring.cqes       = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+    uring.cq_entries = params.cq_entries;
+
+    if (!(uring.fd = create_anonymous_fd( &uring_fd_ops, unix_fd, NULL, 0 ))) return 0;
+    set_fd_events( uring.fd, POLLIN );
+    uring.failed = 0;
+    return 1;
+
+failed:
+    if (sqes != MAP_FAILED) munmap( sqes, sqes_size );
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap( cq_ring, cq_size );
+    if (sq_ring != MAP_FAILED) munmap( sq_ring, sq_size );
+    close( unix_fd );
+    return 0;
+}
+
+/* submit a read to the ring; the async is completed from uring_poll_event() */
+static int uring_queue_read( int unix_fd, struct async *async, void *buffer, data_size_t size,
+                             file_pos_t pos )
+{
+    struct uring_read *read;
+    struct io_uring_sqe *sqe;
+    unsigned int tail, index;
+    int ret;
+
+    if (!init_uring()) return 0;
+    /* don't let the completion queue overflow */
+    if (uring.pending >= uring.cq_entries) return 0;
+    if (!(read = malloc( sizeof(*read) ))) return 0;
+
+    tail = *uring.sq_tail;
+    index = tail & *uring.sq_mask;
+    sqe = &uring.sqes[index];
+    memset( sqe, 0, sizeof(*sqe) );
+    sqe->opcode    = IORING_OP_READ;
+    sqe->fd        = unix_fd;
+    sqe->off       = pos;
+    sqe->addr      = (ULONG_PTR)buffer;
+    sqe->len       = size;
+    sqe->user_data = (ULONG_PTR)read;
+    uring.sq_array[index] = index;
+    __atomic_store_n( uring.sq_tail, tail + 1, __ATOMIC_RELEASE );
+
+    while ((ret = syscall( __NR_io_uring_enter, get_unix_fd( uring.fd ), 1, 0, 0, NULL, 0 )) == -1 &&
+           errno == EINTR);
+    if (ret != 1)
+    {
+        /* nothing was consumed, take the entry back and let the caller read synchronously */
+        __atomic_store_n( uring.sq_tail, tail, __ATOMIC_RELEASE );
+        free( read );
+        return 0;
+    }
+
+    read->async  = (struct async *)grab_object( async );
+    read->buffer = buffer;
+    read->size   = size;
+    uring.pending++;
+    return 1;
+}
+
+#endif  /* HAVE_LINUX_IO_URING_H */
+
+/* read from a regular file at the given position; the read is queued to io_uring when possible */
+static void file_read( struct fd *fd, struct async *async, file_pos_t pos )
+{
+    data_size_t size = get_reply_max_size();
+    void *buffer = NULL;
+    int unix_fd, result;
+
+    if ((unix_fd = get_unix_fd( fd )) == -1) return;
+    if (size && !(buffer = mem_alloc( size ))) return;
+
+#ifdef HAVE_LINUX_IO_URING_H
+    if (size && uring_queue_read( unix_fd, async, buffer, size, pos ))
+    {
+        set_error( STATUS_PENDING );
+        return;
+    }
+#endif
+
+    while ((result = pread( unix_fd, buffer, size, pos )) == -1 && errno == EINTR);
+    if (result == -1)
+    {
+        file_set_error();
+        free( buffer );
+        return;
+    }
+    /* the result is returned directly in the reply */
+    file_read_complete( async, buffer, size, result );
+    set_error( STATUS_PENDING );
+}
+
 struct security_descriptor *mode_to_sd( mode_t mode, const SID *user, const SID *group )
 {
     struct security_descriptor *sd;